@@ -76,8 +76,23 @@ static inline bool IsNumberChar(char ch)
 bool CodeTokenizer::tokenize(std::string_view txt)
 {
     code = txt;
+    return internalTokenize(code);
+}
+
+bool CodeTokenizer::tokenizeFile(const fs::path& path)
+{
+    if (!codeFile.open(path))
+    {
+        *log << "Failed to load content of file " << path << "\n";
+        return false;
+    }
+
+    return internalTokenize(codeFile.view());
+}
 
-    CodeParserState state(code);
+bool CodeTokenizer::internalTokenize(std::string_view txt)
+{
+    CodeParserState state(txt);
 
     while (state.hasContent())
     {
@@ -243,6 +258,18 @@ void CodeTokenizer::handleSingleChar(CodeParserState& s)
     emitToken(s.token(fromPos, fromLine, CodeTokenType::CHAR));
 }
 
+static std::string_view FirstWord(std::string_view txt)
+{
+    while (!txt.empty() && txt.front() <= ' ')
+        txt.remove_prefix(1);
+
+    size_t length = 0;
+    while (length < txt.length() && IsTokenChar(txt[length]))
+        length += 1;
+
+    return txt.substr(0, length);
+}
+
 bool CodeTokenizer::handlePreprocessor(CodeParserState& s)
 {
     const auto* lineStart = s.pos;
@@ -254,7 +281,7 @@ bool CodeTokenizer::handlePreprocessor(CodeParserState& s)
         char ch = s.peek();
         if (ch == '\n')
         {
-            std::cout << contextPath.u8string() << "(" << s.line << "): error: Invalid preprocessor directive\n";
+            *log << contextPath.u8string() << "(" << s.line << "): error: Invalid preprocessor directive\n";
             return false;
         }
 
@@ -297,7 +324,55 @@ bool CodeTokenizer::handlePreprocessor(CodeParserState& s)
 
     auto arguments = s.token(fromPos, fromLine, CodeTokenType::STRING);
 
-    // TODO: any "#pragma" ?
+    // track the #if blocks, the include guard wrapping the whole file does not count
+    if (command.text == "if" || command.text == "ifdef" || command.text == "ifndef")
+    {
+        conditionDepth += 1;
+
+        if (command.text == "ifndef" && numDirectives == 0)
+            guardName = FirstWord(arguments.text);
+    }
+    else if (command.text == "endif")
+    {
+        if (conditionDepth > 0)
+            conditionDepth -= 1;
+
+        if (conditionDepth < guardDepth)
+            guardDepth = 0;
+    }
+    else if (command.text == "define" && numDirectives == 1 && !guardName.empty() && FirstWord(arguments.text) == guardName)
+    {
+        guardDepth = 1;
+    }
+
+    numDirectives += 1;
+
+    if (command.text == "include")
+    {
+        auto path = arguments.text;
+        while (!path.empty() && path.front() <= ' ')
+            path.remove_prefix(1);
+
+        // includes done through macros are not followed
+        if (!path.empty() && (path.front() == '\"' || path.front() == '<'))
+        {
+            const auto closingChar = (path.front() == '<') ? '>' : '\"';
+            const auto closingPos = path.find(closingChar, 1);
+            if (closingPos == std::string_view::npos || closingPos == 1)
+            {
+                *log << contextPath.u8string() << "(" << fromLine << "): warning: Invalid include directive\n";
+            }
+            else
+            {
+                IncludeDirective include;
+                include.path = path.substr(1, closingPos - 1);
+                include.system = (closingChar == '>');
+                include.conditional = (conditionDepth > guardDepth);
+                include.line = fromLine;
+                includes.push_back(include);
+            }
+        }
+    }
 
     return true;
 }
@@ -442,19 +517,19 @@ bool CodeTokenizer::process()
         s.eat();
 
         if (print)
-            std::cout << "Token '" << token.text << "' at line " << token.line << "\n";
+            *log << "Token '" << token.text << "' at line " << token.line << "\n";
 
         if (token.text == "BEGIN_INFERNO_NAMESPACE")
         {
             if (!activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Nested BEGIN_INFERNO_NAMESPACE are not allowed\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Nested BEGIN_INFERNO_NAMESPACE are not allowed\n";
                 return false;
             }
 
             if (!ExtractEmptyBrackets(s))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: This macro variant does not use a name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: This macro variant does not use a name\n";
                 return false;
             }
 
@@ -464,14 +539,14 @@ bool CodeTokenizer::process()
         {
             if (!activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Nested BEGIN_INFERNO_NAMESPACE are not allowed\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Nested BEGIN_INFERNO_NAMESPACE are not allowed\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractNamespaceName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse namespace's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse namespace's name\n";
                 return false;
             }
 
@@ -481,13 +556,13 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Found END_INFERNO_NAMESPACE without previous BEGIN_INFERNO_NAMESPACE\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Found END_INFERNO_NAMESPACE without previous BEGIN_INFERNO_NAMESPACE\n";
                 return false;
             }
 
             if (!ExtractEmptyBrackets(s))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: This macro variant does not use a name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: This macro variant does not use a name\n";
                 return false;
             }
 
@@ -497,14 +572,14 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Found END_INFERNO_NAMESPACE without previous BEGIN_INFERNO_NAMESPACE\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Found END_INFERNO_NAMESPACE without previous BEGIN_INFERNO_NAMESPACE\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractNamespaceName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse namespace's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse namespace's name\n";
                 return false;
             }
 
@@ -512,7 +587,7 @@ bool CodeTokenizer::process()
 
             if (name != activeNamespace)
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Inconsistent namespace name between BEGIN and END macros\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Inconsistent namespace name between BEGIN and END macros\n";
                 return false;
             }
 
@@ -522,14 +597,14 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractIdentName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
                 return false;
             }
 
@@ -549,14 +624,14 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractIdentName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
                 return false;
             }
 
@@ -580,14 +655,14 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractNamespaceName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
                 return false;
             }
 
@@ -607,14 +682,14 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Type declaration can only happen inside the inferno namespace BEGIN/END block\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractIdentName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
                 return false;
             }
 
@@ -634,18 +709,18 @@ bool CodeTokenizer::process()
         {
             if (activeNamespace.empty())
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Global function declaration can only happen inside the inferno namespace BEGIN/END block\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Global function declaration can only happen inside the inferno namespace BEGIN/END block\n";
                 return false;
             }
 
             std::string name;
             if (!ExtractIdentName(s, name))
             {
-                std::cout << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
+                *log << contextPath.u8string() << "(" << token.line << "): error: Unable to parse type's name\n";
                 return false;
             }
     
-            std::cout << "Found function: '" << name << "'\n";
+            *log << "Found function: '" << name << "'\n";
 
             Declaration decl;
             decl.name = name;
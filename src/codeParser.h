@@ -47,23 +47,44 @@ struct CodeTokenizer
         std::string typeName; // namespace without the "inferno::"
     };
 
+    struct IncludeDirective
+    {
+        std::string_view path; // as written, "base_math/include/vector.h"
+        bool system = false; // <file.h> instead of "file.h"
+        bool conditional = false; // inside of an #if block (not counting the include guard)
+        int line = 0;
+    };
+
     //--
 
     fs::path contextPath;
 
+    std::ostream* log = &std::cout; // warnings and errors about the code, workers parsing files in parallel give each file its own buffer
+
     std::vector<CodeToken> tokens;
 
     std::vector<Declaration> declarations;
 
+    std::vector<IncludeDirective> includes; // all #include directives, conditional blocks are not evaluated
+
     CodeTokenizer();
     ~CodeTokenizer();
 
-    bool tokenize(std::string_view txt);
+    bool tokenize(std::string_view txt); // text is copied
+    bool tokenizeFile(const fs::path& path); // file is mapped and the tokens point directly into it, nothing is copied
 
     bool process();
 
 private:
     std::string code;
+    FileView codeFile;
+
+    int numDirectives = 0;
+    int conditionDepth = 0; // #if blocks we are in
+    int guardDepth = 0; // 1 if the outermost #if block is the include guard
+    std::string_view guardName;
+
+    bool internalTokenize(std::string_view txt);
 
     void emitToken(CodeToken txt);
 
@@ -11,6 +11,18 @@
 #include <string_view>
 #include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <charconv>
+#include <type_traits>
+#include <cstdarg>
 
 #include <assert.h>
 
@@ -59,6 +71,15 @@ enum class GeneratorType : uint8_t {
     VisualStudio19,
     VisualStudio22,
     CMake,
+    Ninja,
+
+    MAX,
+};
+
+enum class ProfileGuidedStage : uint8_t {
+    None,
+    Instrument, // executables write the profiles when they are run (trained)
+    Optimize, // optimized using the profiles collected by the instrumented build
 
     MAX,
 };
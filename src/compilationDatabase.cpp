@@ -0,0 +1,200 @@
+#include "common.h"
+#include "project.h"
+#include "projectGenerator.h"
+#include "compilationDatabase.h"
+#include "solutionGeneratorCMAKE.h"
+#include "profiler.h"
+
+//--
+
+void ProjectCompileArguments::extract(const Configuration& config, const ProjectGenerator& gen, const ProjectGenerator::GeneratedProject* p)
+{
+    const auto windowsPlatform = (config.platform == PlatformType::Windows || config.platform == PlatformType::UWP);
+    const auto isApplication = (p->originalProject->type == ProjectType::LocalApplication);
+    const auto staticLink = isApplication ? (config.libs == LibraryType::Static) : !p->willBeDLL;
+
+    // defines, same as in the CMake build
+    {
+        defines.push_back("PROJECT_NAME=" + p->mergedName);
+
+        if (staticLink)
+            defines.push_back("BUILD_AS_LIBS");
+        else
+            defines.push_back(ToUpper(p->mergedName) + "_EXPORTS");
+
+        if (p->willBeDLL)
+            defines.push_back("BUILD_DLL");
+
+        for (const auto* dep : p->allDependencies)
+            if (dep->originalProject->type == ProjectType::LocalLibrary)
+                defines.push_back("HAS_" + ToUpper(dep->mergedName));
+
+        if (config.configuration == ConfigurationType::Debug)
+            defines.insert(defines.end(), { "BUILD_DEBUG", "_DEBUG", "DEBUG" });
+        else if (config.configuration == ConfigurationType::Checked)
+            defines.insert(defines.end(), { "BUILD_CHECKED", "NDEBUG" });
+        else if (config.configuration == ConfigurationType::Release)
+            defines.insert(defines.end(), { "BUILD_RELEASE", "NDEBUG" });
+        else if (config.configuration == ConfigurationType::Final)
+            defines.insert(defines.end(), { "BUILD_RELEASE", "BUILD_FINAL", "NDEBUG" });
+
+        if (windowsPlatform)
+        {
+            defines.insert(defines.end(), { "UNICODE", "_UNICODE", "_WIN64", "_WINDOWS", "WIN32_LEAN_AND_MEAN", "NOMINMAX" });
+            defines.insert(defines.end(), { "_SILENCE_ALL_CXX17_DEPRECATION_WARNINGS", "_SILENCE_TR1_NAMESPACE_DEPRECATION_WARNING", "_SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING" });
+
+            if (p->originalProject->flagConsole)
+                defines.push_back("CONSOLE");
+        }
+    }
+
+    // include directories, same as in the CMake build
+    {
+        ExtractSourceRoots(config, gen, p, includePaths);
+
+        for (const auto* lib : p->originalProject->resolvedDependencies)
+        {
+            if (lib->type == ProjectType::ExternalLibrary)
+            {
+                for (const auto& path : lib->libraryInlcudePaths)
+                    includePaths.push_back(path);
+            }
+            else if (lib->type == ProjectType::LocalLibrary && lib->flagGlobalInclude)
+            {
+                includePaths.push_back(lib->rootPath / "include");
+            }
+        }
+    }
+
+    // compiler flags, same as in the CMake build
+    if (!windowsPlatform)
+    {
+        flags.push_back("-pthread");
+
+        if (p->originalProject->flagAllowExceptions)
+            flags.push_back("-fexceptions");
+        else
+            flags.push_back("-fno-exceptions");
+
+        flags.push_back("-g");
+
+        if (config.configuration == ConfigurationType::Debug)
+            flags.insert(flags.end(), { "-O0", "-fstack-protector-all" });
+        else if (config.configuration == ConfigurationType::Checked)
+            flags.insert(flags.end(), { "-O2", "-fstack-protector-all" });
+        else
+            flags.insert(flags.end(), { "-O3", "-fno-stack-protector" });
+
+        // CMake adds it on its own for the shared libraries
+        if (!isApplication && !staticLink)
+            flags.push_back("-fPIC");
+
+        // CMake picks the variant for the compiler when it configures the project, here it's taken from the CXX tool
+        if (config.pgo != ProfileGuidedStage::None)
+        {
+            const auto profilePath = MakeGenericPath(config.profilePath.u8string());
+
+            if (config.pgo == ProfileGuidedStage::Instrument)
+                profileFlags.insert(profileFlags.end(), { "-fprofile-generate=" + profilePath, "-fprofile-update=atomic" });
+            else if (std::string_view(EnvironmentTool("CXX", "c++")).find("clang") != std::string_view::npos)
+                profileFlags.insert(profileFlags.end(), { "-fprofile-use=" + profilePath, "-Wno-profile-instr-unprofiled", "-Wno-profile-instr-out-of-date" });
+            else
+                profileFlags.insert(profileFlags.end(), { "-fprofile-use=" + profilePath, "-fprofile-correction", "-Wno-missing-profile" });
+        }
+    }
+}
+
+void ProjectCompileArguments::extractProjectSettings(const ProjectGenerator::GeneratedProject* p)
+{
+    std::vector<std::pair<std::string, std::string>> defs;
+    for (const auto* dep : p->allDependencies)
+        CollectDefineStrings(defs, dep->originalProject->globalDefines);
+    CollectDefineStrings(defs, p->originalProject->localDefines);
+
+    for (const auto& def : defs)
+    {
+        if (def.second.empty())
+            defines.push_back(def.first);
+        else
+            defines.push_back(def.first + "=" + def.second);
+    }
+
+    for (const auto& path : p->additionalIncludePaths)
+        includePaths.push_back(path);
+
+    for (const auto& path : p->originalProject->localIncludeDirectories)
+        includePaths.push_back(p->originalProject->rootPath / path);
+}
+
+//--
+
+CompilationDatabaseGenerator::CompilationDatabaseGenerator(const Configuration& config, ProjectGenerator& gen)
+    : m_config(config)
+    , m_gen(gen)
+{}
+
+static std::string JsonPath(const fs::path& path)
+{
+    return JsonString(MakeGenericPath(fs::absolute(path).make_preferred().u8string()));
+}
+
+bool CompilationDatabaseGenerator::generateDatabase()
+{
+    ProfileScope profile("generateCompilationDatabase");
+
+    auto* file = m_gen.createFile(m_config.solutionPath / "compile_commands.json");
+    auto& f = file->content;
+
+    const auto directory = JsonPath(m_config.solutionPath);
+    const auto cc = JsonString(EnvironmentTool("CC", "cc"));
+    const auto cxx = JsonString(EnvironmentTool("CXX", "c++"));
+
+    bool firstEntry = true;
+    f << "[";
+
+    for (const auto* p : m_gen.projects)
+    {
+        if (p->originalProject->type != ProjectType::LocalLibrary && p->originalProject->type != ProjectType::LocalApplication)
+            continue;
+
+        ProjectCompileArguments args;
+        args.extract(m_config, m_gen, p);
+
+        // part of the command line shared by all files in the project
+        std::string projectArgs;
+        for (const auto& define : args.defines)
+            projectArgs += ", " + JsonString("-D" + define);
+        for (const auto& path : args.includePaths)
+            projectArgs += ", " + JsonString("-I" + MakeGenericPath(fs::absolute(path).make_preferred().u8string()));
+        for (const auto& flag : args.flags)
+            projectArgs += ", " + JsonString(flag);
+        for (const auto& flag : args.profileFlags)
+            projectArgs += ", " + JsonString(flag);
+
+        // sources compiled through the unity files are still listed, the tools need a command for every file that is edited
+        for (const auto* pf : p->files)
+        {
+            if (!pf->useInCurrentBuild || pf->type != ProjectFileType::CppSource || pf->unityFile)
+                continue;
+
+            const auto cSource = (pf->absolutePath.extension() == ".c");
+            const auto path = JsonPath(pf->absolutePath);
+
+            f << (firstEntry ? "\n" : ",\n");
+            f << "  {\n";
+            f << "    \"directory\": " << directory << ",\n";
+            f << "    \"file\": " << path << ",\n";
+            f << "    \"arguments\": [" << (cSource ? cc : cxx) << (cSource ? "" : ", \"-std=c++17\"") << projectArgs << ", \"-c\", " << path << "]\n";
+            f << "  }";
+
+            firstEntry = false;
+        }
+    }
+
+    f << "\n]\n";
+
+    m_gen.finishFile(file);
+    return true;
+}
+
+//--
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "utils.h"
+#include "project.h"
+#include "projectGenerator.h"
+
+//--
+
+// Compiler arguments (gcc/clang style) for the sources of a single project
+struct ProjectCompileArguments
+{
+    std::vector<std::string> defines; // "NAME" or "NAME=VALUE"
+    std::vector<fs::path> includePaths;
+    std::vector<std::string> flags;
+    std::vector<std::string> profileFlags; // profile guided optimization, only valid if the linker gets them as well
+
+    void extract(const Configuration& config, const ProjectGenerator& gen, const ProjectGenerator::GeneratedProject* project); // exactly what the CMake build passes
+    void extractProjectSettings(const ProjectGenerator::GeneratedProject* project); // defines and include directories from the build scripts, not passed by the CMake build
+};
+
+//--
+
+// Writes compile_commands.json for the current configuration, used by clangd, clang-tidy and similar tools
+struct CompilationDatabaseGenerator
+{
+    CompilationDatabaseGenerator(const Configuration& config, ProjectGenerator& gen);
+
+    bool generateDatabase();
+
+private:
+    const Configuration& m_config;
+    ProjectGenerator& m_gen;
+};
+
+//--
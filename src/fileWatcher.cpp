@@ -0,0 +1,189 @@
+#include "common.h"
+#include "fileWatcher.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+//--
+
+#ifdef __linux__
+
+static const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR;
+
+FileWatcher::FileWatcher()
+{
+    m_handle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_handle < 0)
+        std::cout << "Failed to initialize inotify, error " << errno << "\n";
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (m_handle >= 0)
+        close(m_handle);
+}
+
+void FileWatcher::syncDirectories(const std::vector<fs::path>& directories)
+{
+    if (m_handle < 0)
+        return;
+
+    std::unordered_set<std::string> wanted;
+    for (const auto& path : directories)
+    {
+        auto pathStr = path.u8string();
+        if (m_watchHandles.find(pathStr) == m_watchHandles.end())
+        {
+            const auto wd = inotify_add_watch(m_handle, pathStr.c_str(), WATCH_MASK);
+            if (wd < 0)
+            {
+                std::cout << "Failed to watch directory " << path << ", error " << errno << "\n";
+                continue;
+            }
+
+            m_watchPaths[wd] = path;
+            m_watchHandles[pathStr] = wd;
+        }
+
+        wanted.insert(std::move(pathStr));
+    }
+
+    for (auto it = m_watchHandles.begin(); it != m_watchHandles.end(); )
+    {
+        if (wanted.find(it->first) == wanted.end())
+        {
+            inotify_rm_watch(m_handle, it->second);
+            m_watchPaths.erase(it->second);
+            it = m_watchHandles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+bool FileWatcher::readEvents(std::vector<Event>& outEvents)
+{
+    alignas(inotify_event) char buffer[16384];
+
+    for (;;)
+    {
+        const auto size = read(m_handle, buffer, sizeof(buffer));
+        if (size < 0)
+            return errno == EAGAIN;
+        if (size == 0)
+            return true;
+
+        for (const char* ptr = buffer; ptr < buffer + size; )
+        {
+            const auto* data = (const inotify_event*)ptr;
+            ptr += sizeof(inotify_event) + data->len;
+
+            Event evt;
+            evt.isDirectory = (data->mask & IN_ISDIR) != 0;
+
+            if (data->mask & IN_Q_OVERFLOW)
+            {
+                evt.type = FileWatcherEventType::Overflow;
+                outEvents.push_back(evt);
+                continue;
+            }
+
+            if (data->mask & IN_IGNORED)
+            {
+                // watch was removed by the system (directory deleted), forget about it
+                auto it = m_watchPaths.find(data->wd);
+                if (it != m_watchPaths.end())
+                {
+                    m_watchHandles.erase(it->second.u8string());
+                    m_watchPaths.erase(it);
+                }
+                continue;
+            }
+
+            if (data->mask & (IN_CREATE | IN_MOVED_TO))
+                evt.type = FileWatcherEventType::Added;
+            else if (data->mask & (IN_DELETE | IN_MOVED_FROM))
+                evt.type = FileWatcherEventType::Removed;
+            else if (data->mask & IN_CLOSE_WRITE)
+                evt.type = FileWatcherEventType::Modified;
+            else
+                continue;
+
+            auto it = m_watchPaths.find(data->wd);
+            if (it == m_watchPaths.end())
+                continue;
+
+            evt.directoryPath = it->second;
+            if (data->len)
+                evt.name = data->name;
+
+            outEvents.push_back(std::move(evt));
+        }
+    }
+}
+
+bool FileWatcher::waitForChanges(std::vector<Event>& outEvents, uint32_t settleTimeMs)
+{
+    if (m_handle < 0)
+        return false;
+
+    pollfd fd;
+    fd.fd = m_handle;
+    fd.events = POLLIN;
+
+    // block until something happens
+    for (;;)
+    {
+        const auto ret = poll(&fd, 1, -1);
+        if (ret > 0)
+            break;
+        if (ret < 0 && errno != EINTR)
+            return false;
+    }
+
+    // keep collecting until it quiets down, saving a file or checking out a branch produces bursts of events
+    for (;;)
+    {
+        if (!readEvents(outEvents))
+            return false;
+
+        fd.revents = 0;
+        const auto ret = poll(&fd, 1, settleTimeMs);
+        if (ret == 0)
+            break;
+        if (ret < 0 && errno != EINTR)
+            return false;
+    }
+
+    return true;
+}
+
+#else
+
+FileWatcher::FileWatcher()
+{}
+
+FileWatcher::~FileWatcher()
+{}
+
+void FileWatcher::syncDirectories(const std::vector<fs::path>& directories)
+{}
+
+bool FileWatcher::readEvents(std::vector<Event>& outEvents)
+{
+    return false;
+}
+
+bool FileWatcher::waitForChanges(std::vector<Event>& outEvents, uint32_t settleTimeMs)
+{
+    return false;
+}
+
+#endif
+
+//--
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.h"
+
+//--
+
+enum class FileWatcherEventType : uint8_t
+{
+    Added, // file or directory was created or moved in
+    Removed, // file or directory was deleted or moved out
+    Modified, // file content was written
+    Overflow, // we lost some events, everything should be considered changed
+};
+
+// Watches a set of directories for changes (not recursive, each directory has to be added)
+// NOTE: only implemented on Linux (inotify), on other platforms the watcher is never valid
+class FileWatcher
+{
+public:
+    struct Event
+    {
+        FileWatcherEventType type;
+        fs::path directoryPath; // directory the change happened in
+        std::string name; // name of the file or directory that changed
+        bool isDirectory = false;
+    };
+
+    FileWatcher();
+    ~FileWatcher();
+
+    inline bool valid() const { return m_handle >= 0; }
+
+    // make sure exactly given directories are watched, new ones are added and not listed ones are removed
+    void syncDirectories(const std::vector<fs::path>& directories);
+
+    // wait for changes, returns once there were no new events for given time
+    bool waitForChanges(std::vector<Event>& outEvents, uint32_t settleTimeMs);
+
+private:
+    int m_handle = -1;
+
+    std::unordered_map<int, fs::path> m_watchPaths;
+    std::unordered_map<std::string, int> m_watchHandles;
+
+    bool readEvents(std::vector<Event>& outEvents);
+};
+
+//--
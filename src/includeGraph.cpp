@@ -0,0 +1,598 @@
+#include "common.h"
+#include "project.h"
+#include "projectGenerator.h"
+#include "compilationDatabase.h"
+#include "includeGraph.h"
+#include "codeParser.h"
+#include "profiler.h"
+
+//--
+
+static std::string NodeKey(const fs::path& path)
+{
+    return MakeGenericPath(fs::absolute(path).lexically_normal().u8string());
+}
+
+IncludeGraph::IncludeGraph(const Configuration& config, ProjectGenerator& gen)
+    : m_config(config)
+    , m_gen(gen)
+{}
+
+IncludeGraph::~IncludeGraph()
+{
+    for (auto* node : nodes)
+        delete node;
+}
+
+IncludeGraph::Node* IncludeGraph::createNode(const std::string& key, const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file)
+{
+    auto* node = new Node;
+    node->index = (uint32_t)nodes.size();
+    node->path = key;
+    node->project = project;
+    node->file = file;
+    nodes.push_back(node);
+    m_nodeMap[key] = node;
+
+    if (project)
+        m_projectNodes[project].push_back(node);
+
+    return node;
+}
+
+const IncludeGraph::Node* IncludeGraph::findNode(const fs::path& path) const
+{
+    auto it = m_nodeMap.find(NodeKey(path));
+    if (it != m_nodeMap.end())
+        return it->second;
+    return nullptr;
+}
+
+bool IncludeGraph::probeFile(const fs::path& path, const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_probeLock);
+        auto it = m_probeCache.find(key);
+        if (it != m_probeCache.end())
+            return it->second;
+    }
+
+    std::error_code ec;
+    const auto exists = fs::is_regular_file(path, ec);
+
+    {
+        std::lock_guard<std::mutex> lock(m_probeLock);
+        m_probeCache[key] = exists;
+    }
+
+    return exists;
+}
+
+struct IncludeGraphParsedInclude
+{
+    std::string path; // as written
+    bool system = false;
+    bool conditional = false;
+};
+
+struct IncludeGraphParsedFile
+{
+    IncludeGraph::Node* node = nullptr;
+    fs::path absolutePath;
+    bool writtenByBuild = false; // reflection.cpp, may not exist yet
+    std::stringstream log; // warnings from the parsing, printed in file order once all files are parsed
+
+    std::vector<IncludeGraphParsedInclude> includes;
+    std::vector<std::string> resolvedIncludes; // node keys, empty if not resolved
+};
+
+void IncludeGraph::build(TaskPool& pool)
+{
+    ProfileScope profile("buildIncludeGraph");
+
+    std::vector<IncludeGraphParsedFile*> files;
+    std::vector<std::vector<IncludeGraphParsedFile*>> projectFiles;
+    std::vector<const ProjectGenerator::GeneratedProject*> projects;
+
+    // all C++ files of the local projects, including the generated ones
+    for (const auto* p : m_gen.projects)
+    {
+        if (p->originalProject->type != ProjectType::LocalLibrary && p->originalProject->type != ProjectType::LocalApplication)
+            continue;
+
+        std::vector<IncludeGraphParsedFile*> parsedFiles;
+        for (const auto* pf : p->files)
+        {
+            if (pf->type != ProjectFileType::CppHeader && pf->type != ProjectFileType::CppSource)
+                continue;
+
+            const auto key = NodeKey(pf->absolutePath);
+            if (m_nodeMap.find(key) != m_nodeMap.end())
+                continue;
+
+            auto* file = new IncludeGraphParsedFile;
+            file->node = createNode(key, p, pf);
+            file->node->translationUnit = (pf->type == ProjectFileType::CppSource) && pf->useInCurrentBuild && !pf->unityBatched;
+            file->node->volatileContent = pf->originalFile && pf->originalFile->flagVolatile;
+            file->absolutePath = pf->absolutePath;
+            file->writtenByBuild = !pf->originalFile && !pf->generatedFile;
+            files.push_back(file);
+            parsedFiles.push_back(file);
+        }
+
+        projects.push_back(p);
+        projectFiles.push_back(std::move(parsedFiles));
+    }
+
+    // extract include directives
+    pool.parallelFor((uint32_t)files.size(), [&files](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            auto* file = files[index];
+
+            std::error_code ec;
+            if (file->writtenByBuild && !fs::is_regular_file(file->absolutePath, ec))
+                return;
+
+            // one unreadable file should not stop the generation, it just stays without includes
+            CodeTokenizer tokenizer;
+            tokenizer.contextPath = file->absolutePath;
+            tokenizer.log = &file->log;
+            if (!tokenizer.tokenizeFile(file->absolutePath))
+            {
+                file->log << file->absolutePath.u8string() << ": warning: Failed to parse include directives, file will have no includes in the include graph\n";
+                return;
+            }
+
+            for (const auto& include : tokenizer.includes)
+            {
+                IncludeGraphParsedInclude info;
+                info.path = std::string(include.path);
+                info.system = include.system;
+                info.conditional = include.conditional;
+                file->includes.push_back(info);
+            }
+        });
+
+    for (const auto* file : files)
+        std::cout << file->log.str();
+
+    // resolve them against the include paths of each project
+    pool.parallelFor((uint32_t)projects.size(), [this, &projects, &projectFiles](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            ProjectCompileArguments args;
+            args.extract(m_config, m_gen, projects[index]);
+            args.extractProjectSettings(projects[index]);
+
+            for (auto* file : projectFiles[index])
+            {
+                const auto localPath = file->absolutePath.parent_path();
+
+                for (const auto& include : file->includes)
+                {
+                    const auto includePath = fs::u8path(include.path);
+
+                    std::string resolvedKey;
+                    const auto resolve = [this, &resolvedKey, &includePath](const fs::path& rootPath)
+                    {
+                        const auto path = rootPath / includePath;
+                        const auto key = NodeKey(path);
+
+                        if (m_nodeMap.find(key) == m_nodeMap.end() && !probeFile(path, key))
+                            return false;
+
+                        resolvedKey = key;
+                        return true;
+                    };
+
+                    if (!include.system)
+                        resolve(localPath);
+
+                    for (const auto& rootPath : args.includePaths)
+                    {
+                        if (!resolvedKey.empty())
+                            break;
+                        resolve(rootPath);
+                    }
+
+                    file->resolvedIncludes.push_back(resolvedKey);
+                }
+            }
+        });
+
+    // link the graph, headers outside of the projects get their own nodes
+    uint32_t numIncludes = 0;
+    uint32_t numUnresolvedIncludes = 0;
+    for (auto* file : files)
+    {
+        auto* node = file->node;
+
+        for (uint32_t i = 0; i < file->includes.size(); ++i)
+        {
+            const auto& include = file->includes[i];
+            const auto& key = file->resolvedIncludes[i];
+            if (key.empty())
+            {
+                if (PushBackUnique(node->unresolvedIncludes, include.path))
+                    numUnresolvedIncludes += 1;
+
+                if (include.system && !include.conditional)
+                    PushBackUnique(node->unconditionalSystemIncludes, include.path);
+            }
+            else
+            {
+                auto it = m_nodeMap.find(key);
+                auto* includedNode = (it != m_nodeMap.end()) ? it->second : createNode(key, nullptr, nullptr);
+                if (includedNode == node)
+                    continue;
+
+                if (PushBackUnique(node->includes, includedNode))
+                    numIncludes += 1;
+
+                if (!include.conditional)
+                    PushBackUnique(node->unconditionalIncludes, includedNode);
+            }
+        }
+
+        delete file;
+    }
+
+    // sizes, used to judge the cost of the headers
+    pool.parallelFor((uint32_t)nodes.size(), [this](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            auto* node = nodes[index];
+
+            std::error_code ec;
+            node->size = fs::file_size(fs::u8path(node->path), ec);
+            if (ec)
+                node->size = 0;
+        });
+
+    computeFanIn(pool);
+
+    std::cout << "Include graph has " << nodes.size() << " files, " << numIncludes << " resolved and " << numUnresolvedIncludes << " unresolved includes\n";
+}
+
+void IncludeGraph::computeFanIn(TaskPool& pool)
+{
+    for (const auto* node : nodes)
+        for (auto* includedNode : node->includes)
+            includedNode->directFanIn += 1;
+
+    std::vector<const Node*> units;
+    for (const auto* node : nodes)
+        if (node->translationUnit)
+            units.push_back(node);
+
+    // each translation unit visits everything it includes once, visited marks are stamped with the unit index so they never need clearing
+    std::vector<std::vector<uint32_t>> workerCounts(pool.numWorkers(), std::vector<uint32_t>(nodes.size(), 0));
+    std::vector<std::vector<uint32_t>> workerVisited(pool.numWorkers(), std::vector<uint32_t>(nodes.size(), 0));
+
+    pool.parallelFor((uint32_t)units.size(), [&units, &workerCounts, &workerVisited](uint32_t index, uint32_t workerIndex)
+        {
+            auto& counts = workerCounts[workerIndex];
+            auto& visited = workerVisited[workerIndex];
+            const auto stamp = index + 1;
+
+            std::vector<const Node*> stack;
+            stack.push_back(units[index]);
+            visited[units[index]->index] = stamp;
+
+            while (!stack.empty())
+            {
+                const auto* node = stack.back();
+                stack.pop_back();
+
+                for (const auto* includedNode : node->includes)
+                {
+                    if (visited[includedNode->index] != stamp)
+                    {
+                        visited[includedNode->index] = stamp;
+                        counts[includedNode->index] += 1;
+                        stack.push_back(includedNode);
+                    }
+                }
+            }
+        });
+
+    for (const auto& counts : workerCounts)
+        for (uint32_t i = 0; i < nodes.size(); ++i)
+            nodes[i]->totalFanIn += counts[i];
+}
+
+bool IncludeGraph::save(const fs::path& path) const
+{
+    std::vector<const Node*> sortedNodes(nodes.begin(), nodes.end());
+    std::sort(sortedNodes.begin(), sortedNodes.end(), [](const Node* a, const Node* b)
+        {
+            if (a->totalFanIn != b->totalFanIn)
+                return a->totalFanIn > b->totalFanIn;
+            if (a->directFanIn != b->directFanIn)
+                return a->directFanIn > b->directFanIn;
+            return a->path < b->path;
+        });
+
+    StringBuilder f;
+    f << "{\n";
+    f << "  \"files\": [";
+
+    bool firstNode = true;
+    for (const auto* node : sortedNodes)
+    {
+        f << (firstNode ? "\n" : ",\n");
+        f << "    {\n";
+        f << "      \"path\": " << JsonString(node->path) << ",\n";
+        f << "      \"project\": " << (node->project ? JsonString(node->project->mergedName) : "null") << ",\n";
+        f << "      \"translationUnit\": " << (node->translationUnit ? "true" : "false") << ",\n";
+        f << "      \"directFanIn\": " << node->directFanIn << ",\n";
+        f << "      \"totalFanIn\": " << node->totalFanIn << ",\n";
+
+        f << "      \"includes\": [";
+        for (uint32_t i = 0; i < node->includes.size(); ++i)
+            f << (i ? ", " : "") << JsonString(node->includes[i]->path);
+        f << "],\n";
+
+        f << "      \"unresolved\": [";
+        for (uint32_t i = 0; i < node->unresolvedIncludes.size(); ++i)
+            f << (i ? ", " : "") << JsonString(node->unresolvedIncludes[i]);
+        f << "]\n";
+
+        f << "    }";
+        firstNode = false;
+    }
+
+    f << "\n  ]\n";
+    f << "}\n";
+
+    return SaveFileFromString(path, f, std::cout, m_config.force);
+}
+
+//--
+
+static const uint32_t AUTO_PCH_MIN_SOURCES = 4; // smaller projects keep the basic build.h, a bigger precompiled header would not pay off
+static const uint32_t AUTO_PCH_MAX_HEADERS = 48; // headers added to a single build.h
+static const uint64_t AUTO_PCH_MAX_SIZE = 4 * 1024 * 1024; // size of the added headers including everything they include
+
+static bool IsSourceFile(const std::string& path)
+{
+    const auto ext = fs::u8path(path).extension().u8string();
+    return ext == ".cpp" || ext == ".c" || ext == ".cc" || ext == ".cxx";
+}
+
+void IncludeGraph::selectPrecompiledHeaders(TaskPool& pool)
+{
+    ProfileScope profile("selectPrecompiledHeaders");
+
+    std::vector<ProjectGenerator::GeneratedProject*> projects;
+    for (auto* p : m_gen.projects)
+        if (p->originalProject->type == ProjectType::LocalLibrary || p->originalProject->type == ProjectType::LocalApplication)
+            projects.push_back(p);
+
+    pool.parallelFor((uint32_t)projects.size(), [this, &projects](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            selectProjectPrecompiledHeaders(projects[index]);
+        });
+
+    uint32_t numHeaders = 0;
+    uint32_t numProjects = 0;
+    for (const auto* p : projects)
+    {
+        if (!p->automaticPchIncludes.empty())
+        {
+            numHeaders += (uint32_t)p->automaticPchIncludes.size();
+            numProjects += 1;
+        }
+    }
+
+    std::cout << "Selected " << numHeaders << " additional precompiled headers for " << numProjects << " projects\n";
+}
+
+void IncludeGraph::selectProjectPrecompiledHeaders(ProjectGenerator::GeneratedProject* project) const
+{
+    // projects generated in one of the previous rounds of the watch mode keep their build.h
+    if (project->generated || !project->originalProject->flagUsePCH || project->originalProject->flagNoAutoPch)
+        return;
+
+    const auto projectNodes = m_projectNodes.find(project);
+    if (projectNodes == m_projectNodes.end())
+        return;
+
+    // only the sources that are actually compiled with the precompiled header
+    std::vector<const Node*> units;
+    for (const auto* node : projectNodes->second)
+        if (node->translationUnit && node->file->originalFile && node->file->originalFile->flagUsePch)
+            units.push_back(node);
+
+    if (units.size() < AUTO_PCH_MIN_SOURCES)
+        return;
+
+    // content that build.h already has
+    std::unordered_set<const Node*> coveredNodes;
+    {
+        std::vector<const Node*> stack;
+
+        for (const auto* node : projectNodes->second)
+            if (node->file->name == "public.h")
+                stack.push_back(node);
+
+        if (project->originalProject->type == ProjectType::LocalApplication)
+        {
+            for (const auto* dep : project->allDependencies)
+            {
+                if (dep->originalProject->type == ProjectType::LocalLibrary)
+                {
+                    if (dep->originalProject->flagModuleRoot || m_config.build != BuildType::Standalone)
+                    {
+                        if (const auto* node = findNode(dep->originalProject->rootPath / "include/public.h"))
+                            stack.push_back(node);
+                    }
+                }
+            }
+        }
+
+        while (!stack.empty())
+        {
+            const auto* node = stack.back();
+            stack.pop_back();
+
+            if (coveredNodes.insert(node).second)
+                stack.insert(stack.end(), node->includes.begin(), node->includes.end());
+        }
+    }
+
+    // count the sources reaching each header, only includes outside of the #if blocks count
+    // headers of the project itself are walked through but never selected, they change too often
+    struct Candidate
+    {
+        const Node* node = nullptr; // empty for the system headers
+        std::string name; // for the system headers
+        uint32_t count = 0;
+        uint32_t order = 0; // first seen
+        uint32_t lastUnit = 0;
+    };
+
+    std::unordered_map<const Node*, Candidate> headers;
+    std::unordered_map<std::string, Candidate> systemHeaders;
+    uint32_t order = 0;
+
+    for (uint32_t i = 0; i < units.size(); ++i)
+    {
+        const auto unitStamp = i + 1;
+
+        std::unordered_set<const Node*> visited;
+        std::vector<const Node*> stack;
+        stack.push_back(units[i]);
+        visited.insert(units[i]);
+
+        while (!stack.empty())
+        {
+            const auto* node = stack.back();
+            stack.pop_back();
+
+            for (const auto& name : node->unconditionalSystemIncludes)
+            {
+                auto& info = systemHeaders[name];
+                if (info.lastUnit != unitStamp)
+                {
+                    if (!info.count)
+                    {
+                        info.name = name;
+                        info.order = order++;
+                    }
+
+                    info.count += 1;
+                    info.lastUnit = unitStamp;
+                }
+            }
+
+            for (const auto* includedNode : node->unconditionalIncludes)
+            {
+                if (!visited.insert(includedNode).second)
+                    continue;
+
+                if (includedNode->project == project)
+                {
+                    stack.push_back(includedNode);
+                }
+                else
+                {
+                    auto& info = headers[includedNode];
+                    if (!info.count)
+                    {
+                        info.node = includedNode;
+                        info.order = order++;
+                    }
+
+                    info.count += 1;
+                }
+            }
+        }
+    }
+
+    // headers included by most of the sources, most popular first
+    const auto generatedPrefix = NodeKey(m_config.solutionPath) + "/";
+
+    std::vector<const Candidate*> candidates;
+    for (const auto& it : headers)
+    {
+        const auto* node = it.first;
+        if (it.second.count * 2 <= units.size())
+            continue;
+        if (coveredNodes.count(node) || IsSourceFile(node->path) || BeginsWith(node->path, generatedPrefix))
+            continue;
+
+        candidates.push_back(&it.second);
+    }
+
+    for (const auto& it : systemHeaders)
+        if (it.second.count * 2 > units.size())
+            candidates.push_back(&it.second);
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate* a, const Candidate* b)
+        {
+            if (a->count != b->count)
+                return a->count > b->count;
+            return a->order < b->order;
+        });
+
+    // fill the budget, the size of everything a header pulls in that is not in build.h yet is counted
+    // size of the system headers is not known, they are only limited by the header count
+    // volatile headers and the ones including them are skipped, any change to them would rebuild the whole project
+    std::vector<const Candidate*> selected;
+    uint64_t totalSize = 0;
+    for (const auto* candidate : candidates)
+    {
+        if (selected.size() >= AUTO_PCH_MAX_HEADERS)
+            break;
+
+        if (candidate->node)
+        {
+            if (coveredNodes.count(candidate->node))
+                continue;
+
+            std::vector<const Node*> newNodes;
+            std::unordered_set<const Node*> visited;
+
+            uint64_t size = 0;
+            bool volatileContent = false;
+            std::vector<const Node*> stack;
+            stack.push_back(candidate->node);
+            while (!stack.empty())
+            {
+                const auto* node = stack.back();
+                stack.pop_back();
+
+                if (coveredNodes.count(node) || !visited.insert(node).second)
+                    continue;
+
+                newNodes.push_back(node);
+                size += node->size;
+                volatileContent |= node->volatileContent;
+                stack.insert(stack.end(), node->includes.begin(), node->includes.end());
+            }
+
+            if (volatileContent || totalSize + size > AUTO_PCH_MAX_SIZE)
+                continue;
+
+            totalSize += size;
+            coveredNodes.insert(newNodes.begin(), newNodes.end());
+        }
+
+        selected.push_back(candidate);
+    }
+
+    // keep the order in which the sources include them
+    std::sort(selected.begin(), selected.end(), [](const Candidate* a, const Candidate* b)
+        {
+            return a->order < b->order;
+        });
+
+    for (const auto* candidate : selected)
+    {
+        if (candidate->node)
+            project->automaticPchIncludes.push_back("\"" + candidate->node->path + "\"");
+        else
+            project->automaticPchIncludes.push_back("<" + candidate->name + ">");
+    }
+}
+
+//--
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "utils.h"
+#include "project.h"
+#include "projectGenerator.h"
+
+//--
+
+// Header dependency graph of the whole solution built from the #include directives of the local projects
+// Includes are resolved like the compiler does it: directory of the including file first (only for "file.h"), then the include paths of the project
+// Headers found outside of the projects (external libraries) are part of the graph but their own includes are not followed
+struct IncludeGraph
+{
+    struct Node
+    {
+        uint32_t index = 0;
+        std::string path; // generic absolute path, also used as a key
+
+        const ProjectGenerator::GeneratedProject* project = nullptr; // empty for external headers
+        const ProjectGenerator::GeneratedProjectFile* file = nullptr; // empty for external headers
+        bool translationUnit = false; // compiled on its own in the current build
+
+        uint64_t size = 0;
+        bool volatileContent = false; // marked as "volatile" in the build.lua of its project
+
+        std::vector<Node*> includes; // resolved includes in order of appearance, no duplicates
+        std::vector<std::string> unresolvedIncludes; // system headers or files that were not found, as written
+
+        std::vector<Node*> unconditionalIncludes; // resolved includes outside of any #if block
+        std::vector<std::string> unconditionalSystemIncludes; // unresolved <file.h> includes outside of any #if block, mostly the standard library
+
+        uint32_t directFanIn = 0; // number of files including this one directly
+        uint32_t totalFanIn = 0; // number of translation units including this one directly or indirectly
+    };
+
+    std::vector<Node*> nodes;
+
+    IncludeGraph(const Configuration& config, ProjectGenerator& gen);
+    ~IncludeGraph();
+
+    void build(TaskPool& pool); // parses the C++ files the projects have at this point, generated ones must already be saved
+    bool save(const fs::path& path) const; // json, hottest headers first
+
+    const Node* findNode(const fs::path& path) const;
+
+    // picks the headers included by most of the sources of each project for its build.h (GeneratedProject::automaticPchIncludes)
+    void selectPrecompiledHeaders(TaskPool& pool);
+
+private:
+    const Configuration& m_config;
+    ProjectGenerator& m_gen;
+
+    std::unordered_map<std::string, Node*> m_nodeMap;
+    std::unordered_map<const ProjectGenerator::GeneratedProject*, std::vector<Node*>> m_projectNodes;
+
+    std::mutex m_probeLock;
+    std::unordered_map<std::string, bool> m_probeCache; // does the file exist on disk
+
+    Node* createNode(const std::string& key, const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file);
+
+    bool probeFile(const fs::path& path, const std::string& key);
+
+    void computeFanIn(TaskPool& pool);
+
+    void selectProjectPrecompiledHeaders(ProjectGenerator::GeneratedProject* project) const;
+};
+
+//--
@@ -3,6 +3,7 @@
 #include "toolMake.h"
 #include "toolReflection.h"
 #include "toolScriptMake.h"
+#include "toolBenchmark.h"
 
 static std::string MergeCommandline(int argc, char** argv)
 {
@@ -47,6 +48,11 @@ int main(int argc, char** argv)
         ToolScriptMake tool;
         return tool.run(argv[0], cmdLine);
     }
+    else if (tool == "benchmark")
+    {
+        ToolBenchmark tool;
+        return tool.run(argv[0], cmdLine);
+    }
     else
     {
         std::cout << "Unknown tool specified\n";
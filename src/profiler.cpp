@@ -0,0 +1,105 @@
+#include "common.h"
+#include "utils.h"
+#include "profiler.h"
+
+//--
+
+struct ProfileSpan
+{
+    const char* name = nullptr;
+    std::string detail;
+    uint32_t threadIndex = 0;
+    int64_t startUs = 0;
+    int64_t durationUs = 0;
+};
+
+static std::atomic<bool> GProfilerEnabled = false;
+static std::chrono::steady_clock::time_point GProfilerStartTime;
+
+static std::mutex GProfilerLock;
+static std::vector<ProfileSpan> GProfilerSpans;
+
+static std::atomic<uint32_t> GProfilerNextThreadIndex = 0;
+static thread_local uint32_t GProfilerThreadIndex = GProfilerNextThreadIndex++;
+
+void Profiler::Start()
+{
+    GProfilerStartTime = std::chrono::steady_clock::now();
+    GProfilerEnabled = true;
+}
+
+bool Profiler::IsEnabled()
+{
+    return GProfilerEnabled;
+}
+
+void Profiler::RecordSpan(const char* name, std::string_view detail, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    ProfileSpan span;
+    span.name = name;
+    span.detail = std::string(detail);
+    span.threadIndex = GProfilerThreadIndex;
+    span.startUs = std::chrono::duration_cast<std::chrono::microseconds>(start - GProfilerStartTime).count();
+    span.durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::unique_lock<std::mutex> lock(GProfilerLock);
+    GProfilerSpans.push_back(std::move(span));
+}
+
+bool Profiler::Save(const fs::path& path)
+{
+    std::stringstream f;
+
+    {
+        std::unique_lock<std::mutex> lock(GProfilerLock);
+
+        f << "{\"traceEvents\":[\n";
+
+        bool first = true;
+        for (const auto& span : GProfilerSpans)
+        {
+            if (!first)
+                f << ",\n";
+            first = false;
+
+            f << "{\"name\":" << JsonString(span.name);
+            f << ",\"cat\":\"make\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.threadIndex;
+            f << ",\"ts\":" << span.startUs << ",\"dur\":" << span.durationUs;
+
+            if (!span.detail.empty())
+            {
+                f << ",\"args\":{\"detail\":" << JsonString(span.detail) << "}";
+            }
+
+            f << "}";
+        }
+
+        f << "\n]}\n";
+    }
+
+    if (!SaveFileFromString(path, f.str(), true))
+        return false;
+
+    std::cout << "Profile written to " << path << "\n";
+    return true;
+}
+
+//--
+
+ProfileScope::ProfileScope(const char* name, std::string_view detail)
+{
+    if (GProfilerEnabled)
+    {
+        m_name = name;
+        m_detail = std::string(detail);
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (m_name)
+        Profiler::RecordSpan(m_name, m_detail, m_start, std::chrono::steady_clock::now());
+}
+
+//--
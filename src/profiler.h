@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.h"
+
+//--
+
+// Collects timed spans of the make pipeline and writes them in the Chrome trace event format (chrome://tracing, Perfetto)
+// Does nothing unless started, spans can be recorded from any thread
+class Profiler
+{
+public:
+    static void Start();
+    static bool IsEnabled();
+
+    // write all spans recorded so far
+    static bool Save(const fs::path& path);
+
+    static void RecordSpan(const char* name, std::string_view detail, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+};
+
+// Records a span covering the lifetime of the object
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name, std::string_view detail = std::string_view());
+    ~ProfileScope();
+
+private:
+    const char* m_name = nullptr; // null if profiling was disabled when the scope was entered
+    std::string m_detail;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+//--
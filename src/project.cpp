@@ -1,5 +1,6 @@
 #include "common.h"
 #include "project.h"
+#include "profiler.h"
 
 //--
 
@@ -143,7 +144,48 @@ bool Configuration::parseOptions(const char* path, const Commandline& cmd)
         }
     }
 
+    {
+        const auto& str = cmd.get("pgo");
+        if (!str.empty() && !ParseProfileGuidedStage(str, this->pgo))
+        {
+            std::cout << "Invalid profile guided optimization stage '" << str << "'specified\n";
+            return false;
+        }
+
+        if (this->pgo != ProfileGuidedStage::None)
+        {
+            if (this->configuration == ConfigurationType::Debug)
+            {
+                std::cout << "Profile guided optimization is not supported in the debug configuration\n";
+                return false;
+            }
+
+            if (this->generator == GeneratorType::Ninja)
+            {
+                std::cout << "Profile guided optimization is supported only with the CMake and Visual Studio generators\n";
+                return false;
+            }
+        }
+    }
+
     force = cmd.has("force");
+    streaming = cmd.has("stream");
+    unity = cmd.has("unity");
+    includeGraph = cmd.has("includeGraph");
+    autoPch = cmd.has("autoPch");
+
+    {
+        const auto& str = cmd.get("threads");
+        if (!str.empty())
+        {
+            Parser parser(str);
+            if (!parser.parseUint32(this->numThreads))
+            {
+                std::cout << "Invalid thread count '" << str << "'specified\n";
+                return false;
+            }
+        }
+    }
 
     return true;
 }
@@ -258,11 +300,28 @@ bool Configuration::parsePaths(const char* executable, const Commandline& cmd)
         }
     }
 
+    if (pgo != ProfileGuidedStage::None)
+    {
+        profilePath = solutionPath / "pgo";
+
+        // MSVC does not create the folder for the profile databases on its own
+        std::error_code ec;
+        if (!fs::is_directory(profilePath, ec))
+        {
+            if (!fs::create_directories(profilePath, ec))
+            {
+                std::cout << "Failed to create profile directory " << profilePath << "\n";
+                return false;
+            }
+        }
+    }
+
     engineSourcesPath = engineSourcesPath.make_preferred();
     projectSourcesPath = projectSourcesPath.make_preferred();
     engineScriptPath = engineScriptPath.make_preferred();
     projectScriptPath = projectScriptPath.make_preferred();
     solutionPath = solutionPath.make_preferred();
+    profilePath = profilePath.make_preferred();
     deployPath = deployPath.make_preferred();
 
     return true;
@@ -338,50 +397,128 @@ void ProjectStructure::ProjectInfo::internalExportConfiguration(lua_State* L, co
     lua_setglobal(L, "UseStaticLibs");
 }
 
-bool ProjectStructure::ProjectInfo::setupProject(const Configuration& config)
+static const uint32_t SCRIPT_CACHE_MAGIC = 0x43415542; // "BUAC"
+
+static int WriteChunkToString(lua_State* /*L*/, const void* data, size_t size, void* userData)
 {
-    lua_State* L = luaL_newstate();  /* create state */
-    if (L == NULL)
+    ((std::string*)userData)->append((const char*)data, size);
+    return 0;
+}
+
+static bool LoadCachedScript(lua_State* L, const fs::path& cachePath, std::string_view code, uint64_t codeHash)
+{
+    FileView data;
+    if (!data.open(cachePath))
+        return false;
+
+    // anything that does not match exactly is treated as a miss, the script is compiled again and the entry overwritten
+    BinaryReader r(data.view());
+    if (r.readUint32() != SCRIPT_CACHE_MAGIC || r.readUint32() != LUA_VERSION_RELEASE_NUM)
+        return false;
+    if (r.readUint64() != codeHash || r.readUint64() != code.length())
+        return false;
+
+    const auto chunkHash = r.readUint64();
+    const auto chunk = r.readString();
+    if (!r.valid() || HashContent(chunk) != chunkHash)
+        return false;
+
+    if (LUA_OK != luaL_loadbufferx(L, chunk.c_str(), chunk.length(), "=build.lua", "b"))
     {
-        std::cout << "Cannot create state: not enough memory\n";
+        lua_pop(L, 1);
         return false;
     }
 
-    L->selfPtr = this;
+    return true;
+}
+
+static void StoreCachedScript(lua_State* L, const fs::path& cachePath, std::string_view code, uint64_t codeHash, std::string_view uniqueName, std::ostream& log)
+{
+    std::string chunk;
+    if (0 != lua_dump(L, &WriteChunkToString, &chunk, 0))
+        return;
+
+    BinaryWriter w;
+    w.writeUint32(SCRIPT_CACHE_MAGIC);
+    w.writeUint32(LUA_VERSION_RELEASE_NUM);
+    w.writeUint64(codeHash);
+    w.writeUint64(code.length());
+    w.writeUint64(HashContent(chunk));
+    w.writeString(chunk);
+
+    // projects with identical scripts share the entry, each one writes its own temporary file
+    SaveBinaryFile(cachePath, w.data(), log, "." + std::string(uniqueName));
+}
+
+lua_State* ProjectStructure::ProjectInfo::CreateScriptState(const Configuration& config)
+{
+    lua_State* L = luaL_newstate();  /* create state */
+    if (L == NULL)
+        return nullptr;
 
     luaL_openlibs(L);
 
     internalRegisterFunctions(L);
     internalExportConfiguration(L, config);
 
+    return L;
+}
+
+bool ProjectStructure::ProjectInfo::setupProject(const Configuration& config, ScriptStates& states, uint32_t workerIndex)
+{
+    ProfileScope profile("setupProject", mergedName);
+
+    lua_State* L = states.acquire(workerIndex);
+    if (L == NULL)
+    {
+        log << "Cannot create state: not enough memory\n";
+        return false;
+    }
+
+    L->selfPtr = this;
+
     auto scriptFilePath = rootPath / "build.lua";
-    std::string code;
-    if (!LoadFileToString(scriptFilePath, code))
+    FileView scriptFile;
+    if (!scriptFile.open(scriptFilePath))
     {
-        std::cout << "Cannot create state: not enough memory\n";
+        log << "Failed to load build script at " << scriptFilePath << "\n";
         return false;
     }
 
-    int ret = luaL_loadstring(L, code.c_str());
-    if (LUA_OK != ret)
+    const auto code = scriptFile.view();
+    scriptHash = HashContent(code);
+
+    // compiled scripts are cached by content, the dump keeps the debug info so errors are reported the same way
+    char cacheName[32];
+    snprintf(cacheName, sizeof(cacheName), "%016llx.luac", (unsigned long long)scriptHash);
+    const auto cachePath = config.solutionPath / "scripts" / cacheName;
+
+    if (!LoadCachedScript(L, cachePath, code, scriptHash))
     {
-        std::string_view text = luaL_checkstring(L, 1);
+        // same chunk name as luaL_loadstring would give, only the first line is ever displayed
+        const auto firstLineEnd = code.find('\n');
+        const auto chunkName = std::string(code.substr(0, (firstLineEnd == std::string_view::npos) ? code.length() : (firstLineEnd + 1)));
 
-        std::cout << "Failed to parse build script at " << scriptFilePath << "\n";
-        std::cout << "LUA error: " << text << "\n";
+        int ret = luaL_loadbufferx(L, code.data(), code.length(), chunkName.c_str(), "t");
+        if (LUA_OK != ret)
+        {
+            std::string_view text = luaL_checkstring(L, 1);
 
-        lua_close(L);
-        return false;
+            log << "Failed to parse build script at " << scriptFilePath << "\n";
+            log << "LUA error: " << text << "\n";
+            return false;
+        }
+
+        StoreCachedScript(L, cachePath, code, scriptHash, mergedName, log);
     }
 
-    ret = lua_pcall(L, 0, 0, 0);
+    int ret = lua_pcall(L, 0, 0, 0);
     if (LUA_OK != ret)
     {
         std::string_view text = luaL_checkstring(L, 1);
 
-        std::cout << "Failed to run loaded script at " << scriptFilePath << "\n";
-        std::cout << "LUA error: " << text << "\n";
-        lua_close(L);
+        log << "Failed to run loaded script at " << scriptFilePath << "\n";
+        log << "LUA error: " << text << "\n";
         return false;
     }
 
@@ -522,6 +659,21 @@ bool ProjectStructure::ProjectInfo::setupProject(const Configuration& config)
     return !hasScriptErrors;
 }
 
+void ProjectStructure::ProjectInfo::flushLog()
+{
+    const auto text = log.str();
+    if (!text.empty())
+    {
+        std::cout << text;
+        log.str(std::string());
+    }
+}
+
+void ProjectStructure::ProjectInfo::probePath(const fs::path& path)
+{
+    probedPaths.emplace_back(path, GetFileTime(path));
+}
+
 ProjectFileType ProjectStructure::ProjectInfo::FileTypeForExtension(std::string_view ext)
 {
     if (ext == ".h" || ext == ".hpp" || ext == ".hxx" || ext == ".inl")
@@ -611,7 +763,7 @@ void ProjectStructure::ProjectInfo::scanFilesAtDir(const fs::path& directoryPath
     }
     catch (fs::filesystem_error& e)
     {
-        std::cout << "Filesystem Error: " << e.what() << "\n";
+        log << "Filesystem Error: " << e.what() << "\n";
     }
 }
 
@@ -655,7 +807,7 @@ void ProjectStructure::ProjectInfo::scanMediaFilesAtDir(const fs::path& director
     }
     catch (fs::filesystem_error& e)
     {
-        std::cout << "Filesystem Error: " << e.what() << "\n";
+        log << "Filesystem Error: " << e.what() << "\n";
     }
 }
 
@@ -691,7 +843,7 @@ int ProjectStructure::ProjectInfo::ExportAtPanic(lua_State* L)
 {
     auto* self = (ProjectInfo*)L->selfPtr;
     std::string_view name = luaL_checkstring(L, 1);
-    std::cout << "Project '" << self->mergedName << "' encountered critical script error: " << name << "\n";
+    self->log << "Project '" << self->mergedName << "' encountered critical script error: " << name << "\n";
     self->hasScriptErrors = true;
     return 0;
 }
@@ -700,7 +852,7 @@ int ProjectStructure::ProjectInfo::ExportAtError(lua_State* L)
 {
     auto* self = (ProjectInfo*)L->selfPtr;
     std::string_view name = luaL_checkstring(L, 1);
-    std::cout << "Project '" << self->mergedName << "' encountered script error: " << name << "\n";
+    self->log << "Project '" << self->mergedName << "' encountered script error: " << name << "\n";
     self->hasScriptErrors = true;
     return 0;
 }
@@ -713,7 +865,7 @@ int ProjectStructure::ProjectInfo::ExportProjectOption(lua_State* L)
 
     if (!self->toggleFlag(name, value))
     {
-        std::cout << "Project '" << self->mergedName << "' uses invalid flag: '" << name << "'\n";
+        self->log << "Project '" << self->mergedName << "' uses invalid flag: '" << name << "'\n";
         self->hasScriptErrors = true;
     }
 
@@ -729,11 +881,12 @@ int ProjectStructure::ProjectInfo::ExportFileOption(lua_State* L)
 
     if (auto* file = self->findFileByRelativePath(name))
     {
-        file->toggleFlag(flag, value);
+        if (!file->toggleFlag(flag, value))
+            self->log << "Unknown file option '" << flag << "' used on file " << file->absolutePath << "\n";
     }
     else
     {
-        std::cout << "Unknown file '" << name << "'\n";
+        self->log << "Unknown file '" << name << "'\n";
         self->hasScriptErrors = true;
     }
 
@@ -748,7 +901,7 @@ int ProjectStructure::ProjectInfo::ExportProjectFilter(lua_State* L)
     auto filter = FilterTypeByName(flag);
     if (filter == ProjectFilePlatformFilter::Invalid)
     {
-        std::cout << "Project'" << self->mergedName << "' has invalid platform filter: '" << flag << "'\n";
+        self->log << "Project'" << self->mergedName << "' has invalid platform filter: '" << flag << "'\n";
         self->hasScriptErrors = true;
     }
 
@@ -762,7 +915,7 @@ int ProjectStructure::ProjectInfo::ExportProjectModuleName(lua_State* L)
     std::string_view name = luaL_checkstring(L, 1);
     if (name.empty())
     {
-        std::cout << "Project'" << self->mergedName << "' has invalid module name : '" << name << "'\n";
+        self->log << "Project'" << self->mergedName << "' has invalid module name : '" << name << "'\n";
         self->hasScriptErrors = true;
     }
 
@@ -779,7 +932,7 @@ int ProjectStructure::ProjectInfo::ExportFileFilter(lua_State* L)
     auto filter = FilterTypeByName(flag);
     if (filter == ProjectFilePlatformFilter::Invalid)
     {
-        std::cout << "File'" << name << "' has invalid platform filter: '" << flag << "'\n";
+        self->log << "File'" << name << "' has invalid platform filter: '" << flag << "'\n";
         self->hasScriptErrors = true;
     }
     else
@@ -790,7 +943,7 @@ int ProjectStructure::ProjectInfo::ExportFileFilter(lua_State* L)
         }
         else
         {
-            std::cout << "Unknown file '" << name << "'\n";
+            self->log << "Unknown file '" << name << "'\n";
             self->hasScriptErrors = true;
         }
     }
@@ -804,15 +957,17 @@ int ProjectStructure::ProjectInfo::ExportDeploy(lua_State* L)
     std::string_view path = luaL_checkstring(L, 1);
 
     auto fullPath = self->rootPath / path;
+    self->probePath(fullPath);
+
     std::error_code ec;
     if (!fs::exists(fullPath, ec))
     {
-        std::cout << "Referenced deployment file '" << path << "' does not exist in the library folder\n";
+        self->log << "Referenced deployment file '" << path << "' does not exist in the library folder\n";
         self->hasScriptErrors = true;
     }
     else if (!fs::is_regular_file(fullPath, ec))
     {
-        std::cout << "Referenced deployment object '" << path << "' is not a file\n";
+        self->log << "Referenced deployment object '" << path << "' is not a file\n";
         self->hasScriptErrors = true;
     }
     else
@@ -831,8 +986,11 @@ int ProjectStructure::ProjectInfo::ExportDeploy(lua_State* L)
     return 0;
 }
 
-static void ScanDeployFiles(const fs::path& rootPath, const fs::path& curPath, std::vector<ProjectStructure::DeployInfo>& outDeploy)
+static void ScanDeployFiles(const fs::path& rootPath, const fs::path& curPath, std::vector<ProjectStructure::DeployInfo>& outDeploy, ProjectStructure::ProjectInfo* project)
 {
+    // files added or removed later change the time of the directory
+    project->probePath(curPath);
+
     try
     {
         for (const auto& entry : fs::directory_iterator(curPath))
@@ -841,7 +999,7 @@ static void ScanDeployFiles(const fs::path& rootPath, const fs::path& curPath, s
 
             if (entry.is_directory())
             {
-                ScanDeployFiles(rootPath, entry.path(), outDeploy);
+                ScanDeployFiles(rootPath, entry.path(), outDeploy, project);
             }
             else if (entry.is_regular_file())
             {
@@ -858,7 +1016,7 @@ static void ScanDeployFiles(const fs::path& rootPath, const fs::path& curPath, s
     }
     catch (fs::filesystem_error& e)
     {
-        std::cout << "Filesystem Error: " << e.what() << "\n";
+        project->log << "Filesystem Error: " << e.what() << "\n";
     }
 }
 
@@ -873,15 +1031,17 @@ int ProjectStructure::ProjectInfo::ExportDeployShared(lua_State* L)
     std::string_view path = luaL_checkstring(L, 1);
 
     auto fullPath = self->rootPath / path;
+    self->probePath(fullPath);
+
     std::error_code ec;
     if (!fs::exists(fullPath, ec))
     {
-        std::cout << "Referenced deployment file '" << path << "' does not exist in the library folder\n";
+        self->log << "Referenced deployment file '" << path << "' does not exist in the library folder\n";
         self->hasScriptErrors = true;
     }
     else if (!fs::is_regular_file(fullPath, ec))
     {
-        std::cout << "Referenced deployment object '" << path << "' is not a file\n";
+        self->log << "Referenced deployment object '" << path << "' is not a file\n";
         self->hasScriptErrors = true;
     }
     else
@@ -906,20 +1066,22 @@ int ProjectStructure::ProjectInfo::ExportDeploySharedDir(lua_State* L)
     std::string_view path = luaL_checkstring(L, 1);
 
     auto fullPath = self->rootPath / path;
+    self->probePath(fullPath);
+
     std::error_code ec;
     if (!fs::exists(fullPath, ec))
     {
-        std::cout << "Referenced deployment directory '" << path << "' does not exist in the library folder\n";
+        self->log << "Referenced deployment directory '" << path << "' does not exist in the library folder\n";
         self->hasScriptErrors = true;
     }
     else if (!fs::is_directory(fullPath, ec))
     {
-        std::cout << "Referenced deployment directory '" << path << "' is not a directory\n";
+        self->log << "Referenced deployment directory '" << path << "' is not a directory\n";
         self->hasScriptErrors = true;
     }
     else
     {
-        ScanDeployFiles(fullPath, fullPath, self->sharedDeployList);
+        ScanDeployFiles(fullPath, fullPath, self->sharedDeployList, self);
     }
 
     return 0;
@@ -933,16 +1095,17 @@ int ProjectStructure::ProjectInfo::ExportTool(lua_State* L)
 
     auto fullPath = self->rootPath / path;
     fullPath = fullPath.make_preferred();
+    self->probePath(fullPath);
 
     std::error_code ec;
     if (!fs::exists(fullPath, ec))
     {
-        std::cout << "Referenced binary file '" << path << "' does not exist\n";
+        self->log << "Referenced binary file '" << path << "' does not exist\n";
         self->hasScriptErrors = true;
     }
     else if (!fs::is_regular_file(fullPath, ec))
     {
-        std::cout << "Referenced binary file '" << path << "' is not a file\n";
+        self->log << "Referenced binary file '" << path << "' is not a file\n";
         self->hasScriptErrors = true;
     }
     else
@@ -962,15 +1125,17 @@ int ProjectStructure::ProjectInfo::ExportLibraryInclude(lua_State* L)
     std::string_view path = luaL_checkstring(L, 1);
 
     auto fullPath = self->rootPath / path;
+    self->probePath(fullPath);
+
     std::error_code ec;
     if (!fs::exists(fullPath, ec))
     {
-        std::cout << "Referenced include path '" << path << "' does not exist in the library folder\n";
+        self->log << "Referenced include path '" << path << "' does not exist in the library folder\n";
         self->hasScriptErrors = true;
     }
     else if (!fs::is_directory(fullPath, ec))
     {
-        std::cout << "Referenced include path '" << path << "' is not a directory\n";
+        self->log << "Referenced include path '" << path << "' is not a directory\n";
         self->hasScriptErrors = true;
     }
     else
@@ -989,16 +1154,17 @@ int ProjectStructure::ProjectInfo::ExportLibraryLink(lua_State* L)
 
     auto fullPath = self->rootPath / path;
     fullPath = fullPath.make_preferred();
+    self->probePath(fullPath);
 
     std::error_code ec;
     if (!fs::exists(fullPath, ec))
     {
-        std::cout << "Referenced file '" << path << "' does not exist in the library folder\n";
+        self->log << "Referenced file '" << path << "' does not exist in the library folder\n";
         self->hasScriptErrors = true;
     }
     else if (!fs::is_regular_file(fullPath, ec))
     {
-        std::cout << "Referenced object '" << path << "' is not a file\n";
+        self->log << "Referenced object '" << path << "' is not a file\n";
         self->hasScriptErrors = true;
     }
     else
@@ -1031,7 +1197,7 @@ int ProjectStructure::ProjectInfo::ExportProjectType(lua_State* L)
         self->type = ProjectType::MonoScriptProject;
     else
     {
-        std::cout << "Project '" << self->mergedName << "' has invalid type: '" << name << "'\n";
+        self->log << "Project '" << self->mergedName << "' has invalid type: '" << name << "'\n";
     }
 
     if (name == "test_app")
@@ -1066,13 +1232,13 @@ int ProjectStructure::ProjectInfo::ExportAppMain(lua_State* L)
 
     if (self->appClassName.empty())
     {
-        std::cout << "Missing app class name\n";
+        self->log << "Missing app class name\n";
         self->hasScriptErrors = true;
     }
 
     if (self->appHeaderName.empty())
     {
-        std::cout << "Missing app header name\n";
+        self->log << "Missing app header name\n";
         self->hasScriptErrors = true;
     }
 
@@ -1151,6 +1317,28 @@ bool ProjectStructure::ProjectInfo::toggleFlag(std::string_view name, bool value
         flagAllowExceptions = !value;
         return true;
     }
+    else if (name == "unity")
+    {
+        flagUnity = value;
+        flagNoUnity = !value;
+        return true;
+    }
+    else if (name == "nounity")
+    {
+        flagUnity = !value;
+        flagNoUnity = value;
+        return true;
+    }
+    else if (name == "autopch")
+    {
+        flagNoAutoPch = !value;
+        return true;
+    }
+    else if (name == "noautopch")
+    {
+        flagNoAutoPch = value;
+        return true;
+    }
     
 
     return false;
@@ -1171,20 +1359,6 @@ bool ProjectStructure::ProjectInfo::internalAddStringOnce(std::vector<std::strin
     return true;
 }
 
-void CollectDefineString(std::vector<std::pair<std::string, std::string>>& ar, std::string_view name, std::string_view value)
-{
-    for (auto& entry : ar)
-    { 
-        if (entry.first == name)
-        {
-            entry.second = value;
-            return;
-        }
-    }
-
-    ar.emplace_back(std::make_pair(name, value));
-}
-
 void ProjectStructure::ProjectInfo::addLocalDefine(std::string_view name, std::string_view value)
 {
     CollectDefineString(localDefines, name, value);
@@ -1203,11 +1377,11 @@ ProjectStructure::FileInfo* ProjectStructure::ProjectInfo::findFileByRelativePat
     return nullptr;
 }
 
-void ProjectStructure::ProjectInfo::collectModuleDependencies(ProjectInfo* mp, std::vector<ProjectInfo*>& outAllDependencies)
+void ProjectStructure::ProjectInfo::collectModuleDependencies(ProjectInfo* mp, OrderedSet<ProjectInfo*>& outAllDependencies)
 {
     if (!moduleProject || moduleProject == mp)
         for (auto* dep : resolvedDependencies)
-            if (PushBackUnique(outAllDependencies, dep))
+            if (outAllDependencies.insert(dep))
                 dep->collectModuleDependencies(mp, outAllDependencies);
 }
 
@@ -1257,8 +1431,22 @@ bool ProjectStructure::FileInfo::toggleFlag(std::string_view name, bool value)
         flagWarn3 = value;
         return true;
     }
+    else if (name == "unity")
+    {
+        flagNoUnity = !value;
+        return true;
+    }
+    else if (name == "nounity")
+    {
+        flagNoUnity = value;
+        return true;
+    }
+    else if (name == "volatile")
+    {
+        flagVolatile = value;
+        return true;
+    }
 
-    std::cout << "Unknown file option '" << name << "' used on file " << absolutePath << "\n";
     return false;
 }
 
@@ -1312,7 +1500,7 @@ ProjectStructure::~ProjectStructure()
         delete group;
 }
 
-static std::string BuildMergedProjectName(const std::vector<std::string_view>& parts)
+static std::string BuildMergedProjectName(const std::vector<std::string>& parts)
 {
     std::string ret;
 
@@ -1326,52 +1514,67 @@ static std::string BuildMergedProjectName(const std::vector<std::string_view>& p
     return ret;
 }
 
-void ProjectStructure::scanProjectsAtDir(ProjectGroup* group, std::vector<std::string_view>& directoryNames, fs::path directoryPath)
+struct ProjectStructure::ScannedDirectory
 {
+    std::vector<std::string> names; // directory names from the scan root
+    std::vector<uint32_t> order; // index of each directory in its parent's listing, used to restore the serial walk order
+    fs::path path;
+    fs::file_time_type time; // captured before listing so changes made during the scan invalidate the snapshot
+    std::string error;
     bool hasBuildLua = false;
+};
 
+static bool IsScannedBefore(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    // depth first post order - same as the recursive walk: children before the parent, siblings in listing order
+    const auto count = std::min(a.size(), b.size());
+    for (size_t i = 0; i < count; ++i)
+        if (a[i] != b[i])
+            return a[i] < b[i];
+
+    return a.size() > b.size();
+}
+
+void ProjectStructure::scanProjectsAtDir(TaskPool& pool, std::vector<std::vector<ScannedDirectory>>& outDirectories, uint32_t workerIndex, ScannedDirectory dir)
+{
     try
     {
-        for (const auto& entry : fs::directory_iterator(directoryPath))
+        dir.time = fs::last_write_time(dir.path);
+
+        uint32_t index = 0;
+        for (const auto& entry : fs::directory_iterator(dir.path))
         {
             const auto name = entry.path().filename().u8string();
 
             if (entry.is_directory())
             {
-                directoryNames.push_back(name);
-                scanProjectsAtDir(group, directoryNames, entry.path());
-                directoryNames.pop_back();
+                ScannedDirectory child;
+                child.names = dir.names;
+                child.names.push_back(name);
+                child.order = dir.order;
+                child.order.push_back(index++);
+                child.path = entry.path();
+
+                pool.submit([this, &pool, &outDirectories, child = std::move(child)](uint32_t childWorkerIndex) mutable {
+                    scanProjectsAtDir(pool, outDirectories, childWorkerIndex, std::move(child));
+                });
             }
             else if (entry.is_regular_file())
             {
                 if (name == "build.lua")
                 {
-                    hasBuildLua = true;
+                    dir.hasBuildLua = true;
                 }
             }
         }
     }
     catch (fs::filesystem_error& e)
     {
-        std::cout << "Filesystem Error: " << e.what() << "\n";
+        dir.error = e.what();
     }
 
-    if (hasBuildLua)
-    {
-        auto* project = new ProjectInfo();
-        project->type = ProjectType::Disabled;
-        project->group = group;
-        project->mergedName = BuildMergedProjectName(directoryNames);
-        project->name = std::string(directoryNames.back());
-        project->rootPath = directoryPath;
-
-        group->projects.push_back(project);
-        projects.push_back(project);
-
-        projectsMap[project->mergedName] = project;
-
-        //std::cout << "Found project '" << project->mergedName << "' at " << project->rootPath << "\n";
-    }
+    // all directories are reported, the snapshot validates the structure using their modification times
+    outDirectories[workerIndex].push_back(std::move(dir));
 }
 
 void ProjectStructure::scanScriptProjectsAtDir(ProjectGroup* group, fs::path directoryPath)
@@ -1428,21 +1631,43 @@ ProjectStructure::ProjectInfo* ProjectStructure::findProject(std::string_view na
     return nullptr;
 }
 
-void ProjectStructure::addProjectDependency(ProjectInfo* project, std::vector<ProjectInfo*>& outProjects)
+void ProjectStructure::buildLibraryIndex()
 {
-    auto it = std::find(outProjects.begin(), outProjects.end(), project);
-    if (it == outProjects.end())
-        outProjects.push_back(project);
+    libraryIndex.clear();
+
+    for (uint32_t i = 0; i < projects.size(); ++i)
+    {
+        auto* proj = projects[i];
+        if (proj->type == ProjectType::LocalLibrary)
+        {
+            LibraryIndexEntry entry;
+            entry.name = proj->mergedName;
+            entry.order = i;
+            entry.project = proj;
+            libraryIndex.push_back(entry);
+        }
+    }
+
+    std::sort(libraryIndex.begin(), libraryIndex.end(), [](const LibraryIndexEntry& a, const LibraryIndexEntry& b) { return a.name < b.name; });
 }
 
-bool ProjectStructure::resolveProjectDependency(std::string_view name, std::vector<ProjectInfo*>& outProjects)
+bool ProjectStructure::resolveProjectDependency(std::string_view name, OrderedSet<ProjectInfo*>& outProjects)
 {
     if (EndsWith(name, "_*"))
     {
         const auto pattern = name.substr(0, name.length() - 1);
-        for (auto* proj : projects)
-            if (BeginsWith(proj->mergedName, pattern) && proj->type == ProjectType::LocalLibrary)
-                addProjectDependency(proj, outProjects);
+
+        // all names with given prefix form a continuous range in the sorted index
+        auto it = std::lower_bound(libraryIndex.begin(), libraryIndex.end(), pattern, [](const LibraryIndexEntry& a, std::string_view b) { return a.name < b; });
+
+        std::vector<const LibraryIndexEntry*> matches;
+        for (; it != libraryIndex.end() && BeginsWith(it->name, pattern); ++it)
+            matches.push_back(&*it);
+
+        std::sort(matches.begin(), matches.end(), [](const LibraryIndexEntry* a, const LibraryIndexEntry* b) { return a->order < b->order; });
+
+        for (const auto* match : matches)
+            outProjects.insert(match->project);
 
         return true;
     }
@@ -1457,7 +1682,7 @@ bool ProjectStructure::resolveProjectDependency(std::string_view name, std::vect
                 return true;
             }
 
-            addProjectDependency(proj, outProjects);
+            outProjects.insert(proj);
             return true;
         }
     }
@@ -1467,11 +1692,21 @@ bool ProjectStructure::resolveProjectDependency(std::string_view name, std::vect
 
 bool ProjectStructure::resolveProjectDependencies(const Configuration& config)
 {
+    ProfileScope profile("resolveProjectDependencies");
+
     bool hasValidDeps = true;
 
+    // the special projects are kept when the dependencies are resolved again in the watch mode
+    const auto findSpecialProject = [this](ProjectType type) -> ProjectInfo* {
+        for (auto* proj : projects)
+            if (proj->type == type)
+                return proj;
+        return nullptr;
+    };
+
     // create the special rtti generator project
-    ProjectInfo* rttiGenerator = nullptr;
-    if (config.generator == GeneratorType::VisualStudio19 || config.generator == GeneratorType::VisualStudio22)
+    ProjectInfo* rttiGenerator = findSpecialProject(ProjectType::RttiGenerator);
+    if (!rttiGenerator && (config.generator == GeneratorType::VisualStudio19 || config.generator == GeneratorType::VisualStudio22))
     {
         rttiGenerator = new ProjectInfo();
         rttiGenerator->name = "_rtti_gen";
@@ -1481,8 +1716,8 @@ bool ProjectStructure::resolveProjectDependencies(const Configuration& config)
     }
 
     // create special media generation project
-    ProjectInfo* embeddGenerator = nullptr;
-    if (config.generator == GeneratorType::VisualStudio19 || config.generator == GeneratorType::VisualStudio22)
+    ProjectInfo* embeddGenerator = findSpecialProject(ProjectType::EmbeddedMedia);
+    if (!embeddGenerator && (config.generator == GeneratorType::VisualStudio19 || config.generator == GeneratorType::VisualStudio22))
     {
         embeddGenerator = new ProjectInfo();
         embeddGenerator->name = "_embedd_files";
@@ -1495,15 +1730,18 @@ bool ProjectStructure::resolveProjectDependencies(const Configuration& config)
     if (!hasValidDeps)
         return false;
 
+    buildLibraryIndex();
+
     // check and resolve dependencies
     for (auto* proj : projects)
     {
         proj->resolvedDependencies.clear();
+        proj->hasMissingDependencies = false;
 
         if (proj->type == ProjectType::LocalApplication || proj->type == ProjectType::LocalLibrary || proj->type == ProjectType::EmbeddedMedia)
         {
             if (rttiGenerator && !BeginsWith(proj->mergedName, "lib_") && (proj != embeddGenerator))
-                proj->resolvedDependencies.push_back(rttiGenerator);
+                proj->resolvedDependencies.insert(rttiGenerator);
 
             for (const auto& dep : proj->dependencies)
             {
@@ -1531,7 +1769,7 @@ bool ProjectStructure::resolveProjectDependencies(const Configuration& config)
         if (proj->type == ProjectType::LocalApplication || proj->type == ProjectType::LocalLibrary)
         {
             if (proj->hasMedia && embeddGenerator)
-                proj->resolvedDependencies.push_back(embeddGenerator);
+                proj->resolvedDependencies.insert(embeddGenerator);
             else
                 std::cout << "Project '" << proj->mergedName << "' will not generate media because tool is not avaialble\n";
         }
@@ -1539,7 +1777,7 @@ bool ProjectStructure::resolveProjectDependencies(const Configuration& config)
 
     if (embeddGenerator)
         if (auto* fileEmbedProject = findProject("tool_fxc"))
-            embeddGenerator->resolvedDependencies.push_back(fileEmbedProject);
+            embeddGenerator->resolvedDependencies.insert(fileEmbedProject);
 
     if (!hasValidDeps)
     {
@@ -1550,8 +1788,10 @@ bool ProjectStructure::resolveProjectDependencies(const Configuration& config)
     return true;
 }
 
-void ProjectStructure::scanProjects(ProjectGroupType groupType, fs::path rootScanPath)
+void ProjectStructure::scanProjects(ProjectGroupType groupType, fs::path rootScanPath, TaskPool& pool)
 {
+    ProfileScope profile("scanProjects", rootScanPath.u8string());
+
     std::cout << "Scanning for projects at " << rootScanPath << "\n";
 
     auto* group = new ProjectGroup;
@@ -1559,8 +1799,52 @@ void ProjectStructure::scanProjects(ProjectGroupType groupType, fs::path rootSca
     group->rootPath = rootScanPath;
     groups.push_back(group);
 
-    std::vector<std::string_view> directoryNames;
-    scanProjectsAtDir(group, directoryNames, rootScanPath);
+    // walk the directories in parallel, each worker collects its own results
+    std::vector<std::vector<ScannedDirectory>> workerDirectories(pool.numWorkers());
+    {
+        ScannedDirectory root;
+        root.path = rootScanPath;
+
+        pool.submit([this, &pool, &workerDirectories, root = std::move(root)](uint32_t workerIndex) mutable {
+            scanProjectsAtDir(pool, workerDirectories, workerIndex, std::move(root));
+        });
+
+        pool.wait();
+    }
+
+    // restore the order the directories would be visited in by a recursive walk so the output does not depend on the scheduling
+    std::vector<ScannedDirectory> directories;
+    for (auto& list : workerDirectories)
+        std::move(list.begin(), list.end(), std::back_inserter(directories));
+
+    std::sort(directories.begin(), directories.end(), [](const ScannedDirectory& a, const ScannedDirectory& b) {
+        return IsScannedBefore(a.order, b.order);
+        });
+
+    for (const auto& dir : directories)
+    {
+        if (!dir.error.empty())
+            std::cout << "Filesystem Error: " << dir.error << "\n";
+        else
+            scannedDirectories.emplace_back(dir.path, dir.time);
+
+        if (dir.hasBuildLua)
+        {
+            auto* project = new ProjectInfo();
+            project->type = ProjectType::Disabled;
+            project->group = group;
+            project->mergedName = BuildMergedProjectName(dir.names);
+            project->name = dir.names.back();
+            project->rootPath = dir.path;
+
+            group->projects.push_back(project);
+            projects.push_back(project);
+
+            projectsMap[project->mergedName] = project;
+
+            //std::cout << "Found project '" << project->mergedName << "' at " << project->rootPath << "\n";
+        }
+    }
 
     std::cout << "Discovered " << group->projects.size() << " project(s)\n";
 }
@@ -1581,9 +1865,14 @@ void ProjectStructure::scanScriptProjects(ProjectGroupType groupType, fs::path r
 
 bool ProjectStructure::makeModules(const Configuration& config)
 {
+    ProfileScope profile("makeModules");
+
     auto oldProjects = std::move(projects);
     auto oldProjectMap = std::move(projectsMap);
 
+    OrderedSet<ProjectInfo*> newProjects; // the final list of projects, in order of creation
+    std::unordered_set<const ProjectInfo*> groupedProjects; // projects already added back to their group
+
     ProjectGroup* moduleGroup = nullptr;
 
     for (auto* group : groups)
@@ -1619,8 +1908,9 @@ bool ProjectStructure::makeModules(const Configuration& config)
                 moduleProject->group = moduleGroup;
                 moduleProject->type = ProjectType::LocalLibrary;
                 moduleGroup->projects.push_back(moduleProject);
+                groupedProjects.insert(moduleProject);
 
-                projects.push_back(moduleProject);
+                newProjects.insert(moduleProject);
                 projectsMap[moduleProject->mergedName] = moduleProject;
 
                 numModules += 1;
@@ -1639,9 +1929,9 @@ bool ProjectStructure::makeModules(const Configuration& config)
         }
         else if (proj->type == ProjectType::RttiGenerator)
         {
-            if (proj->group)
-                PushBackUnique(proj->group->projects, proj);
-            projects.push_back(proj);
+            if (proj->group && groupedProjects.insert(proj).second)
+                proj->group->projects.push_back(proj);
+            newProjects.insert(proj);
         }
     }
 
@@ -1649,23 +1939,23 @@ bool ProjectStructure::makeModules(const Configuration& config)
     {
         if (proj->moduleProject)
         {
-            std::vector<ProjectInfo*> allDependencies;
+            OrderedSet<ProjectInfo*> allDependencies;
             proj->collectModuleDependencies(proj->moduleProject, allDependencies);
 
             for (auto* dep : allDependencies)
             {
                 if (dep->moduleProject && dep->moduleProject != proj->moduleProject)
                 {
-                    PushBackUnique(proj->moduleProject->resolvedDependencies, dep->moduleProject);
+                    proj->moduleProject->resolvedDependencies.insert(dep->moduleProject);
                 }
                 else if (dep->type == ProjectType::RttiGenerator || dep->type == ProjectType::ExternalLibrary || BeginsWith(dep->mergedName, "lib_"))
                 {
-                    proj->moduleProject->resolvedDependencies.push_back(dep);
+                    proj->moduleProject->resolvedDependencies.insert(dep);
 
-                    if (dep->group)
-                        PushBackUnique(dep->group->projects, dep);
+                    if (dep->group && groupedProjects.insert(dep).second)
+                        dep->group->projects.push_back(dep);
 
-                    if (PushBackUnique(projects, dep))
+                    if (newProjects.insert(dep))
                     {
                         std::cout << "Discovered non-module dependency that has to be kept to '" << dep->mergedName << "'\n";
                         projectsMap[dep->mergedName] = dep;
@@ -1675,6 +1965,8 @@ bool ProjectStructure::makeModules(const Configuration& config)
         }
     }
 
+    projects = newProjects.items();
+
     std::cout << "Created " << numModules << " module projects\n";
 
     if (!numModules)
@@ -1686,34 +1978,427 @@ bool ProjectStructure::makeModules(const Configuration& config)
     return true;
 }
 
-bool ProjectStructure::setupProjects(const Configuration& config)
+//--
+
+// copy all entries of the table at given index into a new table left on the top of the stack
+static void CopyTableShallow(lua_State* L, int index)
+{
+    lua_newtable(L);
+
+    lua_pushnil(L);
+    while (lua_next(L, index))
+    {
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        lua_rawset(L, -4);
+    }
+}
+
+// bring the table back to the content of the baseline table, the values themselves are not restored
+static void RestoreTableShallow(lua_State* L, int index, int baselineIndex)
+{
+    // remove entries added since the baseline was captured, clearing existing fields is allowed during the traversal
+    lua_pushnil(L);
+    while (lua_next(L, index))
+    {
+        lua_pop(L, 1);
+
+        lua_pushvalue(L, -1);
+        const auto known = (LUA_TNIL != lua_rawget(L, baselineIndex));
+        lua_pop(L, 1);
+
+        if (!known)
+        {
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, index);
+        }
+    }
+
+    // put back entries that were changed or removed
+    lua_pushnil(L);
+    while (lua_next(L, baselineIndex))
+    {
+        lua_pushvalue(L, -2);
+        lua_rawget(L, index);
+        const auto same = lua_rawequal(L, -1, -2);
+        lua_pop(L, 1);
+
+        if (!same)
+        {
+            lua_pushvalue(L, -2);
+            lua_insert(L, -2);
+            lua_rawset(L, index);
+        }
+        else
+        {
+            lua_pop(L, 1);
+        }
+    }
+}
+
+// key in the table copies under which the metatable of the original table is kept
+static const char BASELINE_METATABLE_KEY = 0;
+
+// remember the content of the table at given index and of all tables reachable from it, the copies are stored in the table at baselineIndex
+static void CollectBaselineTables(lua_State* L, int index, int baselineIndex)
+{
+    lua_pushvalue(L, index);
+    const auto visited = (LUA_TNIL != lua_rawget(L, baselineIndex));
+    lua_pop(L, 1);
+
+    if (visited)
+        return;
+
+    luaL_checkstack(L, 8, "baseline tables");
+
+    lua_pushvalue(L, index);
+    CopyTableShallow(L, index);
+
+    lua_pushlightuserdata(L, (void*)&BASELINE_METATABLE_KEY);
+    if (!lua_getmetatable(L, index))
+        lua_pushboolean(L, 0);
+    lua_rawset(L, -3);
+
+    lua_rawset(L, baselineIndex);
+
+    lua_pushnil(L);
+    while (lua_next(L, index))
+    {
+        if (lua_type(L, -1) == LUA_TTABLE)
+            CollectBaselineTables(L, lua_gettop(L), baselineIndex);
+        lua_pop(L, 1);
+    }
+
+    if (lua_getmetatable(L, index))
+    {
+        CollectBaselineTables(L, lua_gettop(L), baselineIndex);
+        lua_pop(L, 1);
+    }
+}
+
+// check if the table at given index still has exactly the content of its copy
+static bool CompareTableShallow(lua_State* L, int index, int copyIndex)
+{
+    uint32_t numEntries = 0;
+
+    lua_pushnil(L);
+    while (lua_next(L, index))
+    {
+        lua_pushvalue(L, -2);
+        lua_rawget(L, copyIndex);
+        const auto same = lua_rawequal(L, -1, -2);
+        lua_pop(L, 2);
+
+        if (!same)
+        {
+            lua_pop(L, 1);
+            return false;
+        }
+
+        numEntries += 1;
+    }
+
+    lua_pushlightuserdata(L, (void*)&BASELINE_METATABLE_KEY);
+    lua_rawget(L, copyIndex);
+    if (!lua_getmetatable(L, index))
+        lua_pushboolean(L, 0);
+    const auto sameMetatable = lua_rawequal(L, -1, -2);
+    lua_pop(L, 2);
+
+    if (!sameMetatable)
+        return false;
+
+    // the copy has one extra entry for the metatable
+    uint32_t numCopyEntries = 0;
+    lua_pushnil(L);
+    while (lua_next(L, copyIndex))
+    {
+        lua_pop(L, 1);
+        numCopyEntries += 1;
+    }
+
+    return numCopyEntries == numEntries + 1;
+}
+
+// basic types that can have a metatable shared by all of their values (strings have one by default)
+static void PushMetatableTypeSamples(lua_State* L)
+{
+    lua_pushnil(L);
+    lua_pushboolean(L, 0);
+    lua_pushlightuserdata(L, nullptr);
+    lua_pushinteger(L, 0);
+    lua_pushliteral(L, "");
+    lua_pushcfunction(L, &lua_gettop);
+    lua_pushthread(L);
+}
+
+static const int NUM_METATABLE_TYPE_SAMPLES = 7;
+
+// capture everything the scripts could change outside of the globals, must be called on an empty stack
+static void CaptureBaseline(lua_State* L)
+{
+    // remember what the globals looked like before any script was run
+    lua_pushglobaltable(L);
+    CopyTableShallow(L, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, "BaselineGlobals");
+
+    lua_getfield(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+    CopyTableShallow(L, 2);
+    lua_setfield(L, LUA_REGISTRYINDEX, "BaselineLoaded");
+    lua_settop(L, 0);
+
+    // the metatables of the basic types
+    lua_createtable(L, NUM_METATABLE_TYPE_SAMPLES, 0);
+    PushMetatableTypeSamples(L);
+    for (int i = 1; i <= NUM_METATABLE_TYPE_SAMPLES; ++i)
+    {
+        if (!lua_getmetatable(L, 1 + i))
+            lua_pushboolean(L, 0);
+        lua_rawseti(L, 1, i);
+    }
+    lua_settop(L, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, "BaselineTypeMetatables");
+
+    // all tables reachable from the registry: libraries, loaded modules, metatables and the registry itself
+    lua_newtable(L);
+    lua_pushvalue(L, 1);
+    lua_pushboolean(L, 1);
+    lua_rawset(L, 1);
+    lua_pushvalue(L, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, "BaselineTables");
+
+    lua_pushvalue(L, LUA_REGISTRYINDEX);
+    CollectBaselineTables(L, 2, 1);
+
+    PushMetatableTypeSamples(L);
+    for (int i = 1; i <= NUM_METATABLE_TYPE_SAMPLES; ++i)
+    {
+        if (lua_getmetatable(L, 2 + i))
+        {
+            CollectBaselineTables(L, lua_gettop(L), 1);
+            lua_pop(L, 1);
+        }
+    }
+
+    lua_settop(L, 0);
+}
+
+// check that nothing except the globals and the loaded modules was changed since the baseline was captured, must be called on an empty stack
+static bool CheckBaseline(lua_State* L)
 {
     bool valid = true;
 
-    for (auto* project : projects)
-        valid &= project->setupProject(config);
+    lua_getfield(L, LUA_REGISTRYINDEX, "BaselineTypeMetatables");
+    PushMetatableTypeSamples(L);
+    for (int i = 1; i <= NUM_METATABLE_TYPE_SAMPLES && valid; ++i)
+    {
+        lua_rawgeti(L, 1, i);
+        if (!lua_getmetatable(L, 1 + i))
+            lua_pushboolean(L, 0);
+        valid &= lua_rawequal(L, -1, -2);
+        lua_pop(L, 2);
+    }
+    lua_settop(L, 0);
+
+    lua_getfield(L, LUA_REGISTRYINDEX, "BaselineTables");
+    lua_pushnil(L);
+    while (valid && lua_next(L, 1))
+    {
+        if (lua_type(L, -1) == LUA_TTABLE)
+            valid &= CompareTableShallow(L, 2, 3);
+        lua_pop(L, 1);
+    }
+
+    lua_settop(L, 0);
+    return valid;
+}
+
+ProjectStructure::ScriptStates::ScriptStates(const Configuration& config, uint32_t numWorkers)
+    : m_config(config)
+    , m_states(numWorkers, nullptr)
+{}
+
+ProjectStructure::ScriptStates::~ScriptStates()
+{
+    for (auto* L : m_states)
+        if (L)
+            lua_close(L);
+}
+
+lua_State* ProjectStructure::ScriptStates::acquire(uint32_t workerIndex)
+{
+    auto*& L = m_states[workerIndex];
+
+    if (L)
+    {
+        // restore the globals and the loaded modules, they are changed by most of the scripts
+        lua_settop(L, 0);
+
+        lua_pushglobaltable(L);
+        lua_getfield(L, LUA_REGISTRYINDEX, "BaselineGlobals");
+        RestoreTableShallow(L, 1, 2);
+
+        lua_pushnil(L);
+        lua_setmetatable(L, 1);
+
+        lua_getfield(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+        lua_getfield(L, LUA_REGISTRYINDEX, "BaselineLoaded");
+        RestoreTableShallow(L, 3, 4);
+
+        lua_settop(L, 0);
+
+        // a script that changed anything else (library tables, metatables, registry) could affect the next one, start from scratch
+        if (CheckBaseline(L))
+            return L;
+
+        lua_close(L);
+        L = nullptr;
+    }
+
+    L = ProjectInfo::CreateScriptState(m_config);
+    if (!L)
+        return nullptr;
+
+    CaptureBaseline(L);
+    return L;
+}
+
+//--
+
+bool ProjectStructure::setupProjects(const Configuration& config, TaskPool& pool)
+{
+    ProfileScope profile("setupProjects");
+
+    // each worker runs the scripts in its own LUA state so they can be evaluated in parallel
+    std::vector<uint8_t> results(projects.size(), false);
+
+    ScriptStates states(config, pool.numWorkers());
+
+    pool.parallelFor((uint32_t)projects.size(), [this, &config, &states, &results](uint32_t index, uint32_t workerIndex) {
+        results[index] = projects[index]->setupProject(config, states, workerIndex);
+        });
+
+    // report errors in the project order
+    bool valid = true;
+
+    for (size_t i = 0; i < projects.size(); ++i)
+    {
+        projects[i]->flushLog();
+        valid &= (results[i] != 0);
+    }
 
     return valid;
 }
 
-bool ProjectStructure::scanContent(uint32_t& outTotalFiles)
+bool ProjectStructure::scanContent(uint32_t& outTotalFiles, TaskPool& pool)
 {
+    ProfileScope profile("scanContent");
+
+    std::vector<uint8_t> results(projects.size(), false);
+
+    pool.parallelFor((uint32_t)projects.size(), [this, &results](uint32_t index, uint32_t /*workerIndex*/) {
+        results[index] = projects[index]->scanContent();
+        });
+
+    // merge in the project order so the output is the same regardless of the scheduling
     bool valid = true;
 
     outTotalFiles = 0;
 
-    //#pragma omp parallel num_threads(16)
-    for (auto* project : projects)
+    for (size_t i = 0; i < projects.size(); ++i)
     {
-        valid &= project->scanContent();
+        auto* project = projects[i];
+        project->flushLog();
+
+        valid &= (results[i] != 0);
         outTotalFiles += (uint32_t)project->files.size();
     }
 
     return valid;
 }
 
+ProjectStructure::ProjectInfo* ProjectStructure::findProjectForPath(const fs::path& path) const
+{
+    ProjectInfo* ret = nullptr;
+    size_t retLength = 0;
+
+    const auto pathStr = path.u8string();
+    for (auto* project : projects)
+    {
+        const auto rootStr = project->rootPath.u8string();
+        if (rootStr.length() > retLength && BeginsWith(pathStr, rootStr))
+        {
+            // make sure we matched whole directory name
+            if (pathStr.length() == rootStr.length() || pathStr[rootStr.length()] == '/' || pathStr[rootStr.length()] == '\\')
+            {
+                ret = project;
+                retLength = rootStr.length();
+            }
+        }
+    }
+
+    return ret;
+}
+
+bool ProjectStructure::refreshProjects(const std::vector<ProjectInfo*>& changedProjects, const Configuration& config, TaskPool& pool)
+{
+    ProfileScope profile("refreshProjects");
+
+    // directory times are captured before scanning so we don't miss changes that happen during the refresh
+    pool.parallelFor((uint32_t)scannedDirectories.size(), [this](uint32_t index, uint32_t /*workerIndex*/) {
+        std::error_code ec;
+        const auto time = fs::last_write_time(scannedDirectories[index].first, ec);
+        if (!ec)
+            scannedDirectories[index].second = time;
+        });
+
+    // start from a clean project, the scripts only add stuff
+    std::vector<ProjectInfo*> newProjects;
+    for (auto* oldProject : changedProjects)
+    {
+        auto* project = new ProjectInfo();
+        project->type = ProjectType::Disabled;
+        project->group = oldProject->group;
+        project->name = oldProject->name;
+        project->mergedName = oldProject->mergedName;
+        project->rootPath = oldProject->rootPath;
+
+        std::replace(projects.begin(), projects.end(), oldProject, project);
+        std::replace(project->group->projects.begin(), project->group->projects.end(), oldProject, project);
+        projectsMap[project->mergedName] = project;
+
+        newProjects.push_back(project);
+        delete oldProject;
+    }
+
+    std::vector<uint8_t> results(newProjects.size(), false);
+
+    ScriptStates states(config, pool.numWorkers());
+
+    pool.parallelFor((uint32_t)newProjects.size(), [&newProjects, &config, &states, &results](uint32_t index, uint32_t workerIndex) {
+        auto* project = newProjects[index];
+        results[index] = project->scanContent() && project->setupProject(config, states, workerIndex);
+        });
+
+    bool valid = true;
+
+    for (size_t i = 0; i < newProjects.size(); ++i)
+    {
+        auto* project = newProjects[i];
+        project->flushLog();
+
+        std::cout << "Refreshed project '" << project->mergedName << "' (" << project->files.size() << " files)\n";
+        valid &= (results[i] != 0);
+    }
+
+    return valid;
+}
+
 bool ProjectStructure::deployFiles(const Configuration& config)
 {
+    ProfileScope profile("deployFiles");
+
     bool valid = true;
 
     for (const auto* proj : projects)
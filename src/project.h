@@ -2,6 +2,7 @@
 
 #include "common.h"
 #include "utils.h"
+#include "taskPool.h"
 
 //--
 
@@ -43,6 +44,7 @@ struct Configuration;
 struct ProjectStructure
 {
     struct ProjectInfo;
+    class ScriptStates;
 
     struct FileInfo
     {
@@ -55,6 +57,8 @@ struct ProjectStructure
         bool flagNoWarnings = false;
         bool flagWarn3 = false;
         bool flagExcluded = false;
+        bool flagNoUnity = false; // always compiled on its own, never batched into an unity file
+        bool flagVolatile = false; // header that changes often, never added to build.h by -autoPch
 
         const ProjectInfo* originalProject = nullptr;
 
@@ -110,6 +114,9 @@ struct ProjectStructure
         bool flagModuleRoot = false; // artificial project that is a module root
         bool flagGenerateMain = false;
         bool flagAllowExceptions = false;
+        bool flagUnity = false; // batch sources into unity files even if not requested from command line
+        bool flagNoUnity = false; // never use unity files, even if requested from command line
+        bool flagNoAutoPch = false; // keep the basic build.h, even if -autoPch is requested from command line
 
         std::string moduleName; // name of the module to create
         ProjectInfo* moduleProject = nullptr;
@@ -120,10 +127,11 @@ struct ProjectStructure
         ProjectFilePlatformFilter filter = ProjectFilePlatformFilter::Any;
 
         fs::path rootPath; // directory with "build.lua"    
+        uint64_t scriptHash = 0; // hash of the "build.lua" content, used to validate the snapshot
 
         std::vector<std::string> dependencies;
         std::vector<std::string> optionalDependencies;
-        std::vector<ProjectInfo*> resolvedDependencies;
+        OrderedSet<ProjectInfo*> resolvedDependencies;
         std::vector<std::string> localIncludeDirectories;
 
         std::vector<std::pair<std::string, std::string>> localDefines; // local defines to add when compiling this project alone
@@ -137,6 +145,8 @@ struct ProjectStructure
 
         std::vector<std::string> externalIncludePaths; // external include path to add to project, used mostly for headers shared with rendering (constant buffer layouts)
 
+        std::vector<std::pair<fs::path, fs::file_time_type>> probedPaths; // files and directories the script has looked at with their modification time, used to validate the snapshot
+
         std::string appClassName;
         std::string appHeaderName;
         
@@ -150,13 +160,21 @@ struct ProjectStructure
         std::vector<FileInfo*> files;
         std::unordered_map<std::string, FileInfo*> filesMapByRelativePath;
 
+        std::stringstream log; // messages produced while the project is processed on a worker thread
+
         //--
 
         ~ProjectInfo();
 
         bool scanContent(); // scan for actual files
 
-        bool setupProject(const Configuration& config); // runs lua to discover content of the project, NOTE: result may depend on the configuration
+        void flushLog(); // print and clear the buffered messages
+
+        void probePath(const fs::path& path); // remember the current state of a file or directory the script depends on
+
+        bool setupProject(const Configuration& config, ScriptStates& states, uint32_t workerIndex); // runs lua to discover content of the project, NOTE: result may depend on the configuration
+
+        static lua_State* CreateScriptState(const Configuration& config); // state with the libraries, exported functions and configuration, not bound to any project
 
         bool toggleFlag(std::string_view name, bool value);
 
@@ -168,7 +186,7 @@ struct ProjectStructure
 
         const ToolInfo* findToolByName(std::string_view name) const;
 
-        void collectModuleDependencies(ProjectInfo* moduleProject, std::vector<ProjectInfo*>& outAllDependencies);
+        void collectModuleDependencies(ProjectInfo* moduleProject, OrderedSet<ProjectInfo*>& outAllDependencies);
 
     private:
         static int ExportAtPanic(lua_State* L);
@@ -198,10 +216,10 @@ struct ProjectStructure
 
         bool internalAddStringOnce(std::vector<std::string>& deps, std::string_view name);
 
-        void internalRegisterFunctions(lua_State* L);
-        void internalRegisterFunction(lua_State* L, const char* name, lua_CFunction ptr);
+        static void internalRegisterFunctions(lua_State* L);
+        static void internalRegisterFunction(lua_State* L, const char* name, lua_CFunction ptr);
 
-        void internalExportConfiguration(lua_State* L, const Configuration& config);
+        static void internalExportConfiguration(lua_State* L, const Configuration& config);
 
         void scanFilesAtDir(const fs::path& directoryPath, bool headersOnly);
         bool internalTryAddFileFromPath(const fs::path& absolutePath, bool headersOnly);
@@ -213,19 +231,36 @@ struct ProjectStructure
         static ProjectFilePlatformFilter FilterTypeByName(std::string_view ext);
     };
 
+    // pre-initialized LUA states, one per worker, reset to the initial globals before each script is run
+    // states in which a script changed anything else (library tables, metatables, registry) are created again
+    class ScriptStates
+    {
+    public:
+        ScriptStates(const Configuration& config, uint32_t numWorkers);
+        ~ScriptStates();
+
+        lua_State* acquire(uint32_t workerIndex); // created on first use
+
+    private:
+        const Configuration& m_config;
+        std::vector<lua_State*> m_states;
+    };
+
     std::vector<ProjectGroup*> groups;
     std::vector<ProjectInfo*> projects;
     std::unordered_map<std::string, ProjectInfo*> projectsMap;
 
+    std::vector<std::pair<fs::path, fs::file_time_type>> scannedDirectories; // every directory visited by the scan with its modification time
+
     ~ProjectStructure();
 
-    void scanProjects(ProjectGroupType group, fs::path rootScanPath);
+    void scanProjects(ProjectGroupType group, fs::path rootScanPath, TaskPool& pool);
     void scanScriptProjects(ProjectGroupType group, fs::path rootScanPath);
 
     bool makeModules(const Configuration& config);
 
-    bool setupProjects(const Configuration& config);
-    bool scanContent(uint32_t& outTotalFiles);
+    bool setupProjects(const Configuration& config, TaskPool& pool);
+    bool scanContent(uint32_t& outTotalFiles, TaskPool& pool);
 
     ProjectInfo* findProject(std::string_view name);
 
@@ -233,11 +268,37 @@ struct ProjectStructure
 
     bool deployFiles(const Configuration& config);
 
+    // snapshot of the scanned and set up structure, lets us skip the scan and the scripts if nothing on disk has changed
+    bool saveSnapshot(const fs::path& path, const Configuration& config, std::ostream& log) const;
+    bool loadSnapshot(const fs::path& path, const Configuration& config, TaskPool& pool);
+
+    void writeSnapshot(BinaryWriter& w, const Configuration& config) const;
+    bool readSnapshot(std::string_view data, const Configuration& config, TaskPool& pool, bool validate); // validation checks the state of files on disk
+
+    // rescan the content and rerun the scripts of given projects, the projects are replaced with new ones
+    bool refreshProjects(const std::vector<ProjectInfo*>& changedProjects, const Configuration& config, TaskPool& pool);
+
+    // find project that owns given directory, the deepest one is returned for nested projects
+    ProjectInfo* findProjectForPath(const fs::path& path) const;
+
 private:
-    void scanProjectsAtDir(ProjectGroup* group, std::vector<std::string_view>& directoryNames, fs::path directoryPath);
+    struct ScannedDirectory;
+
+    void scanProjectsAtDir(TaskPool& pool, std::vector<std::vector<ScannedDirectory>>& outDirectories, uint32_t workerIndex, ScannedDirectory dir);
     void scanScriptProjectsAtDir(ProjectGroup* group, fs::path directoryPath);
-    bool resolveProjectDependency(std::string_view name, std::vector<ProjectInfo*>& outProjects);
-    void addProjectDependency(ProjectInfo* project, std::vector<ProjectInfo*>& outProjects);
+    bool resolveProjectDependency(std::string_view name, OrderedSet<ProjectInfo*>& outProjects);
+
+    // local libraries sorted by name, "name_*" dependencies are resolved with a binary search over it
+    struct LibraryIndexEntry
+    {
+        std::string_view name;
+        uint32_t order = 0; // index in the projects list, matches are reported in that order
+        ProjectInfo* project = nullptr;
+    };
+
+    std::vector<LibraryIndexEntry> libraryIndex;
+
+    void buildLibraryIndex();
 };
 
 //--
@@ -293,8 +354,15 @@ struct Configuration
     GeneratorType generator;
     LibraryType libs;
     ConfigurationType configuration;
+    ProfileGuidedStage pgo = ProfileGuidedStage::None; // both stages use the same solution folder, GCC finds the profiles by the object file paths
 
     bool force = false; // usually means force write all files
+    bool streaming = false; // save generated files as soon as they are complete instead of keeping them all in memory
+    bool unity = false; // batch sources of all projects into unity files, projects may still opt out
+    bool includeGraph = false; // write the header dependency graph of the solution to include_graph.json
+    bool autoPch = false; // add stable headers used by most of the project's sources to its build.h
+
+    uint32_t numThreads = 0; // worker threads to use, 0 - all hardware threads
 
     fs::path builderExecutablePath;
     fs::path builderEnvPath;
@@ -309,6 +377,7 @@ struct Configuration
     fs::path projectScriptPath;
 
     fs::path solutionPath; // build folder
+    fs::path profilePath; // profiles of the instrumented executables, "solution/pgo"
     fs::path deployPath; // "bin" folder when all crap is written
 
     fs::path sharedDeployPath; // ".bin/.shared"
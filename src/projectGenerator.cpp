@@ -1,9 +1,12 @@
 #include "common.h"
 #include "project.h"
 #include "projectGenerator.h"
+#include "profiler.h"
 
 //--
 
+static std::mutex GToolDirectoryLock; // protects the process working directory while an external tool is running
+
 FileGenerator::GeneratedFile* FileGenerator::createFile(const fs::path& path)
 {
     auto file = new GeneratedFile(path);
@@ -11,16 +14,64 @@ FileGenerator::GeneratedFile* FileGenerator::createFile(const fs::path& path)
     return file;
 }
 
-bool FileGenerator::saveFiles()
+OutputManifest* FileGenerator::manifest()
 {
-    bool valid = true;
+    if (manifestPath.empty())
+        return nullptr;
+
+    std::call_once(m_manifestLoaded, [this]() { m_manifest.load(manifestPath); });
+    return &m_manifest;
+}
+
+void FileGenerator::saveFile(GeneratedFile* file)
+{
+    ProfileScope fileProfile("saveFile", Profiler::IsEnabled() ? file->absolutePath.u8string() : std::string());
+
+    std::stringstream log;
+    file->saveResult = SaveFileFromString(file->absolutePath, file->content, log, false, &file->saveCount, file->customtTime, manifest());
+    file->saveLog = log.str();
+    file->saved = true;
+}
+
+void FileGenerator::finishFile(GeneratedFile* file)
+{
+    if (streaming && !file->saved)
+    {
+        saveFile(file);
+        file->content.clear();
+    }
+}
+
+bool FileGenerator::saveFiles(TaskPool& pool)
+{
+    ProfileScope profile("saveFiles");
 
+    // files are saved in parallel but the messages are reported in the order the files were created
+    std::vector<GeneratedFile*> pendingFiles;
+    for (auto* file : files)
+        if (!file->saved)
+            pendingFiles.push_back(file);
+
+    pool.parallelFor((uint32_t)pendingFiles.size(), [this, &pendingFiles](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            saveFile(pendingFiles[index]);
+        });
+
+    bool valid = true;
     uint32_t numSavedFiles = 0;
     for (const auto* file : files)
-        valid &= SaveFileFromString(file->absolutePath, file->content.str(), false, &numSavedFiles, file->customtTime);
+    {
+        std::cout << file->saveLog;
+        numSavedFiles += file->saveCount;
+        valid &= file->saveResult;
+    }
 
     std::cout << "Saved " << numSavedFiles << " files\n";
 
+    if (const auto* outputManifest = manifest())
+        if (!outputManifest->save(manifestPath, std::cout))
+            std::cout << "Failed to save output manifest " << manifestPath << "\n";
+
     if (!valid)
     {
         std::cout << "Failed to save some output files, generated solution may not be valid\n";
@@ -43,49 +94,141 @@ ProjectGenerator::ProjectGenerator(const Configuration& config)
     sharedGlueFolder = config.solutionPath / "generated" / "_shared";
 }
 
-struct OrderedGraphBuilder
+// Dependency graph of all generated projects, computed in a single topological pass
+// Projects are numbered in the post order (dependencies before the projects that use them) and the transitive dependencies are kept as dense bitsets
+struct DependencyGraph
 {
-    std::unordered_map<ProjectGenerator::GeneratedProject*, int> depthMap;    
+    typedef ProjectGenerator::GeneratedProject Project;
+
+    std::vector<Project*> orderedProjects; // post order, dependencies first
+    std::unordered_map<const Project*, uint32_t> projectIds; // index in the orderedProjects
 
-    bool insertProject(ProjectGenerator::GeneratedProject* p, int depth, std::vector<ProjectGenerator::GeneratedProject*>& stack)
+    std::vector<std::vector<uint32_t>> directDependencies; // per project id
+    std::vector<std::vector<uint64_t>> allDependencies; // per project id, bit for every project reachable through dependencies
+
+    bool build(const std::vector<Project*>& projects)
     {
-        if (find(stack.begin(), stack.end(), p) != stack.end())
-        {
-            std::cout << "Recursive project dependencies found when project '" << p->mergedName << "' was encountered second time\n";
-            for (const auto* proj : stack)
-                std::cout << "  Reachable from '" << proj->mergedName << "'\n";
-            return false;
-        }
+        enum class VisitState : uint8_t { None, Visiting, Visited };
+        std::unordered_map<const Project*, VisitState> visitState;
+
+        bool valid = true;
 
-        auto currentDepth = depthMap[p];
-        if (depth > currentDepth)
+        std::vector<Project*> stack;
+        std::function<void(Project*)> visit = [&](Project* p)
         {
-            depthMap[p] = depth;
+            auto& state = visitState[p];
+            if (state == VisitState::Visited)
+                return;
 
+            if (state == VisitState::Visiting)
+            {
+                std::cout << "Recursive project dependencies found when project '" << p->mergedName << "' was encountered second time\n";
+                for (const auto* proj : stack)
+                    std::cout << "  Reachable from '" << proj->mergedName << "'\n";
+                valid = false;
+                return;
+            }
+
+            state = VisitState::Visiting;
             stack.push_back(p);
 
             for (auto* dep : p->directDependencies)
-                if (!insertProject(dep, depth + 1, stack))
-                    return false;
+                visit(dep);
 
             stack.pop_back();
+            visitState[p] = VisitState::Visited;
+
+            projectIds[p] = (uint32_t)orderedProjects.size();
+            orderedProjects.push_back(p);
+        };
+
+        for (auto* proj : projects)
+            visit(proj);
+
+        if (!valid)
+            return false;
+
+        // dependencies always have lower id than the project so a single pass over the ids is enough
+        const auto numWords = (orderedProjects.size() + 63) / 64;
+        directDependencies.resize(orderedProjects.size());
+        allDependencies.resize(orderedProjects.size());
+
+        for (uint32_t id = 0; id < orderedProjects.size(); ++id)
+        {
+            auto& bits = allDependencies[id];
+            bits.resize(numWords, 0);
+
+            for (const auto* dep : orderedProjects[id]->directDependencies)
+            {
+                const auto depId = projectIds[dep];
+                directDependencies[id].push_back(depId);
+
+                const auto& depBits = allDependencies[depId];
+                for (size_t i = 0; i < numWords; ++i)
+                    bits[i] |= depBits[i];
+
+                bits[depId / 64] |= 1ULL << (depId % 64);
+            }
         }
 
         return true;
     }
 
-    void extractOrderedList(std::vector<ProjectGenerator::GeneratedProject*>& outList) const
+    inline bool hasDependency(uint32_t id, uint32_t depId) const
+    {
+        return 0 != (allDependencies[id][depId / 64] & (1ULL << (depId % 64)));
+    }
+
+    // all dependencies of given project, the deepest ones (longest path from the project) go first, ties are sorted by name
+    void extractDependencies(const Project* project, std::vector<int>& depthMap, std::vector<Project*>& outList) const
+    {
+        const auto id = projectIds.find(project)->second;
+
+        depthMap.assign(id + 1, 0);
+
+        // visit projects that use given dependency before the dependency itself
+        for (uint32_t cur = id + 1; cur-- > 0; )
+        {
+            if (cur != id && !hasDependency(id, cur))
+                continue;
+
+            for (const auto depId : directDependencies[cur])
+                depthMap[depId] = std::max(depthMap[depId], depthMap[cur] + 1);
+        }
+
+        const auto firstIndex = outList.size();
+        for (uint32_t cur = 0; cur < id; ++cur)
+            if (hasDependency(id, cur))
+                outList.push_back(orderedProjects[cur]);
+
+        sortByDepth(outList.begin() + firstIndex, outList.end(), depthMap);
+    }
+
+    // all projects, the ones that are deepest in the graph (longest chain of projects using them) go first, ties are sorted by name
+    void extractOrderedList(std::vector<Project*>& outList) const
+    {
+        std::vector<int> depthMap(orderedProjects.size(), 1);
+
+        for (uint32_t cur = (uint32_t)orderedProjects.size(); cur-- > 0; )
+            for (const auto depId : directDependencies[cur])
+                depthMap[depId] = std::max(depthMap[depId], depthMap[cur] + 1);
+
+        const auto firstIndex = outList.size();
+        outList.insert(outList.end(), orderedProjects.begin(), orderedProjects.end());
+
+        sortByDepth(outList.begin() + firstIndex, outList.end(), depthMap);
+    }
+
+private:
+    void sortByDepth(std::vector<Project*>::iterator begin, std::vector<Project*>::iterator end, const std::vector<int>& depthMap) const
     {
-        std::vector<std::pair<ProjectGenerator::GeneratedProject*, int>> pairs;
-        std::copy(depthMap.begin(), depthMap.end(), std::back_inserter(pairs));
-        std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) -> bool {
-            if (a.second != b.second)
-                return a.second > b.second;
-            return a.first->mergedName < b.first->mergedName;
+        std::sort(begin, end, [this, &depthMap](const Project* a, const Project* b) -> bool {
+            const auto depthA = depthMap[projectIds.find(a)->second];
+            const auto depthB = depthMap[projectIds.find(b)->second];
+            if (depthA != depthB)
+                return depthA > depthB;
+            return a->mergedName < b->mergedName;
             });
-        
-        for (const auto& pair : pairs)
-            outList.push_back(pair.first);
     }
 };
 
@@ -116,8 +259,98 @@ ProjectGenerator::GeneratedGroup* ProjectGenerator::createGroup(std::string_view
     return cur;
 }
 
+ProjectGenerator::GeneratedProject* ProjectGenerator::createProject(const ProjectStructure::ProjectInfo* proj)
+{
+    // do not include dev-only project in standalone builds
+    if (config.build != BuildType::Development)
+    {
+        if (proj->flagDevOnly)
+            return nullptr;
+
+        if (!CheckPlatformFilter(proj->filter, config.platform))
+        {
+            std::cout << "Skipped project '" << proj->mergedName << "' because its not compatible with current platform\n";
+            return nullptr;
+        }
+    }
+
+    // create wrapper
+    auto* generatorProject = new GeneratedProject;
+    generatorProject->mergedName = proj->mergedName;
+    generatorProject->originalProject = proj;
+    generatorProject->generatedPath = config.solutionPath / "generated" / proj->mergedName;
+    generatorProject->projectPath = config.solutionPath / "projects" / proj->mergedName;
+    generatorProject->outputPath = config.solutionPath / "output" / proj->mergedName;
+    generatorProject->hasEmbeddedFiles = proj->hasMedia;
+
+    projects.push_back(generatorProject);
+    projectsMap[proj] = generatorProject;
+
+    // create file wrappers
+    for (const auto* file : proj->files)
+    {
+        auto* info = new GeneratedProjectFile;
+        info->absolutePath = file->absolutePath;
+        info->filterPath = fs::relative(file->absolutePath.parent_path(), proj->rootPath).u8string();
+        if (info->filterPath == ".")
+            info->filterPath.clear();
+        info->name = file->name;
+        info->originalFile = file;
+        info->type = file->type;
+        info->useInCurrentBuild = file->checkFilter(config.platform);
+
+        if (config.build != BuildType::Development)
+        {
+            if (EndsWith(file->name, "_test.cpp") || EndsWith(file->name, "_tests.cpp"))
+            {
+                info->useInCurrentBuild = false;
+            }
+        }
+
+        generatorProject->files.push_back(info);
+    }
+
+    // add project to group
+    bool fullProject = (proj->type == ProjectType::LocalApplication || proj->type == ProjectType::LocalLibrary);
+    generatorProject->group = createGroup(fullProject ? PartBefore(proj->mergedName, "_") : "");
+    generatorProject->group->projects.push_back(generatorProject);
+
+    // determine project guid
+    generatorProject->assignedVSGuid = GuidFromText(generatorProject->mergedName);
+
+    // determine if this project will be a DLL
+    if (proj->type == ProjectType::LocalLibrary)
+    {
+        if (proj->flagForceSharedLibrary)
+            generatorProject->willBeDLL = true;
+        else if (proj->flagForceStaticLibrary)
+            generatorProject->willBeDLL = false;
+        else
+            generatorProject->willBeDLL = (config.libs == LibraryType::Shared);
+
+        if (config.libs == LibraryType::Shared)
+            generatorProject->willBeLinked = generatorProject->willBeDLL;
+        else
+            generatorProject->willBeLinked = true;
+    }
+    else
+    {
+        generatorProject->willBeDLL = false;
+
+        if (proj->type == ProjectType::LocalApplication)
+        {
+            generatorProject->willBeLinked = true;
+            generatorProject->willHaveEntryPoint = true;
+        }
+    }
+
+    return generatorProject;
+}
+
 bool ProjectGenerator::extractProjects(const ProjectStructure& structure)
 {
+    ProfileScope profile("extractProjects");
+
     // validate some settings
     if (config.platform == PlatformType::UWP)
     {
@@ -139,88 +372,7 @@ bool ProjectGenerator::extractProjects(const ProjectStructure& structure)
     {
         if (proj->type == ProjectType::LocalApplication || proj->type == ProjectType::LocalLibrary || proj->type == ProjectType::RttiGenerator || proj->type == ProjectType::EmbeddedMedia)
         {
-            // do not include dev-only project in standalone builds
-            if (config.build != BuildType::Development)
-            {
-                if (proj->flagDevOnly)
-                    continue;
-
-                if (!CheckPlatformFilter(proj->filter, config.platform))
-                {
-                    std::cout << "Skipped project '" << proj->mergedName << "' because its not compatible with current platform\n";
-                    continue;
-                }
-            }
-
-            // create wrapper
-            auto* generatorProject = new GeneratedProject;
-            generatorProject->mergedName = proj->mergedName;
-            generatorProject->originalProject = proj;
-            generatorProject->generatedPath = config.solutionPath / "generated" / proj->mergedName;
-            generatorProject->projectPath = config.solutionPath / "projects" / proj->mergedName;
-            generatorProject->outputPath = config.solutionPath / "output" / proj->mergedName;
-            generatorProject->hasEmbeddedFiles = proj->hasMedia;
-
-            projects.push_back(generatorProject);
-            projectsMap[proj] = generatorProject;
-
-            // create file wrappers
-            for (const auto* file : proj->files)
-            {
-                auto* info = new GeneratedProjectFile;
-                info->absolutePath = file->absolutePath;
-                info->filterPath = fs::relative(file->absolutePath.parent_path(), proj->rootPath).u8string();
-                if (info->filterPath == ".")
-                    info->filterPath.clear();
-                info->name = file->name;
-                info->originalFile = file;
-                info->type = file->type;
-                info->useInCurrentBuild = file->checkFilter(config.platform);
-
-                if (config.build != BuildType::Development)
-                {
-                    if (EndsWith(file->name, "_test.cpp") || EndsWith(file->name, "_tests.cpp"))
-                    {
-                        info->useInCurrentBuild = false;
-                    }
-                }
-
-                generatorProject->files.push_back(info);
-            }
-
-            // add project to group
-            bool fullProject = (proj->type == ProjectType::LocalApplication || proj->type == ProjectType::LocalLibrary);
-            generatorProject->group = createGroup(fullProject ? PartBefore(proj->mergedName, "_") : "");
-            generatorProject->group->projects.push_back(generatorProject);
-
-            // determine project guid
-            generatorProject->assignedVSGuid = GuidFromText(generatorProject->mergedName);
-
-            // determine if this project will be a DLL
-            if (proj->type == ProjectType::LocalLibrary)
-            {
-                if (proj->flagForceSharedLibrary)
-                    generatorProject->willBeDLL = true;
-                else if (proj->flagForceStaticLibrary)
-                    generatorProject->willBeDLL = false;
-                else
-                    generatorProject->willBeDLL = (config.libs == LibraryType::Shared);
-
-                if (config.libs == LibraryType::Shared)
-                    generatorProject->willBeLinked = generatorProject->willBeDLL;
-                else
-                    generatorProject->willBeLinked = true;
-            }
-            else
-            {
-                generatorProject->willBeDLL = false;
-
-                if (proj->type == ProjectType::LocalApplication)
-                {
-                    generatorProject->willBeLinked = true;
-                    generatorProject->willHaveEntryPoint = true;
-                }
-            }
+            createProject(proj);
         }
 
         // create script projects
@@ -253,6 +405,139 @@ bool ProjectGenerator::extractProjects(const ProjectStructure& structure)
         }
     }
 
+    return linkProjects(structure);
+}
+
+// removes the groups left without projects, returns true if the group itself is empty
+static bool RemoveEmptyGroups(ProjectGenerator::GeneratedGroup* group)
+{
+    auto it = std::remove_if(group->children.begin(), group->children.end(), [](ProjectGenerator::GeneratedGroup* child) {
+        if (!RemoveEmptyGroups(child))
+            return false;
+
+        delete child;
+        return true;
+        });
+
+    group->children.erase(it, group->children.end());
+    return group->children.empty() && group->projects.empty();
+}
+
+bool ProjectGenerator::refreshProjects(const ProjectStructure& structure, const std::unordered_set<std::string>& changedProjects)
+{
+    ProfileScope profile("refreshProjects");
+
+    // projects using the changed ones are generated again, both with the old and the new dependencies
+    // the old projects of the changed ones point to the replaced structure projects so only the names are used
+    std::unordered_set<std::string> refreshedProjects = changedProjects;
+    for (const auto* proj : projects)
+        for (const auto* dep : proj->allDependencies)
+            if (changedProjects.count(dep->mergedName))
+                refreshedProjects.insert(proj->mergedName);
+
+    for (bool added = true; added; )
+    {
+        added = false;
+        for (const auto* proj : structure.projects)
+        {
+            if (refreshedProjects.count(proj->mergedName))
+                continue;
+
+            for (const auto* dep : proj->resolvedDependencies)
+            {
+                if (refreshedProjects.count(dep->mergedName))
+                {
+                    refreshedProjects.insert(proj->mergedName);
+                    added = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // the solution-wide projects list files of all other projects
+    for (const auto* proj : structure.projects)
+        if (proj->type == ProjectType::RttiGenerator || proj->type == ProjectType::EmbeddedMedia)
+            refreshedProjects.insert(proj->mergedName);
+
+    // drop the old projects, the remaining ones keep everything generated for them before
+    std::vector<GeneratedProject*> keptProjects;
+    for (auto* proj : projects)
+    {
+        if (refreshedProjects.count(proj->mergedName))
+        {
+            for (auto* file : proj->files)
+                delete file;
+            delete proj;
+        }
+        else
+        {
+            keptProjects.push_back(proj);
+        }
+    }
+
+    projects = std::move(keptProjects);
+
+    projectsMap.clear();
+    for (auto* proj : projects)
+        projectsMap[proj->originalProject] = proj;
+
+    uint32_t numRefreshedProjects = 0;
+    for (const auto* proj : structure.projects)
+    {
+        if (refreshedProjects.count(proj->mergedName))
+        {
+            if (proj->type == ProjectType::LocalApplication || proj->type == ProjectType::LocalLibrary || proj->type == ProjectType::RttiGenerator || proj->type == ProjectType::EmbeddedMedia)
+                if (createProject(proj))
+                    numRefreshedProjects += 1;
+        }
+    }
+
+    // same order of projects in the groups as if all of them were created at once
+    std::vector<GeneratedGroup*> groups;
+    groups.push_back(rootGroup);
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        groups[i]->projects.clear();
+        groups.insert(groups.end(), groups[i]->children.begin(), groups[i]->children.end());
+    }
+
+    for (const auto* proj : structure.projects)
+    {
+        auto it = projectsMap.find(proj);
+        if (it != projectsMap.end())
+            it->second->group->projects.push_back(it->second);
+    }
+
+    RemoveEmptyGroups(rootGroup);
+
+    std::cout << "Regenerating " << numRefreshedProjects << " of " << projects.size() << " project(s)\n";
+    return linkProjects(structure);
+}
+
+void ProjectGenerator::releaseFiles()
+{
+    for (auto* file : files)
+        delete file;
+    files.clear();
+
+    for (auto* proj : projects)
+    {
+        for (auto* file : proj->files)
+            file->generatedFile = nullptr;
+
+        proj->generated = true;
+    }
+}
+
+bool ProjectGenerator::linkProjects(const ProjectStructure& structure)
+{
+    for (auto* proj : projects)
+    {
+        proj->directDependencies.clear();
+        proj->allDependencies.clear();
+    }
+
     // map dependencies
     for (auto* proj : projects)
     {
@@ -268,28 +553,15 @@ bool ProjectGenerator::extractProjects(const ProjectStructure& structure)
         }
     }
 
-    // build merged dependencies
-    bool validDeps = true;
-    for (auto* proj : projects)
-    {
-        std::vector<ProjectGenerator::GeneratedProject*> stack;
-        stack.push_back(proj);
-
-        OrderedGraphBuilder graph;
-        for (auto* dep : proj->directDependencies)
-            validDeps &= graph.insertProject(dep, 1, stack);
-        graph.extractOrderedList(proj->allDependencies);
-    }
+    // build merged dependencies and the final project list
+    DependencyGraph graph;
+    if (!graph.build(projects))
+        return false;
 
-    // build final project list
     {
-        auto temp = std::move(projects);
-
-        std::vector<ProjectGenerator::GeneratedProject*> stack;
-
-        OrderedGraphBuilder graph;
-        for (auto* proj : temp)
-            validDeps &= graph.insertProject(proj, 1, stack);
+        std::vector<int> depthMap;
+        for (auto* proj : projects)
+            graph.extractDependencies(proj, depthMap, proj->allDependencies);
 
         projects.clear();
         graph.extractOrderedList(projects);
@@ -307,35 +579,104 @@ bool ProjectGenerator::extractProjects(const ProjectStructure& structure)
     }
 
     // extract base include directories (source code roots)
+    sourceRoots.clear();
     for (const auto* group : structure.groups)
         sourceRoots.push_back(group->rootPath);
 
-    return validDeps;
+    return true;
 }
 
 //--
 
-bool ProjectGenerator::generateAutomaticCode()
+void ProjectGenerator::GeneratedProject::flushLog()
 {
-    bool valid = true;
+    const auto text = log.str();
+    if (!text.empty())
+    {
+        std::cout << text;
+        log.str(std::string());
+    }
+}
+
+ProjectGenerator::GeneratedFile* ProjectGenerator::createProjectFile(GeneratedProject* project, const fs::path& path)
+{
+    auto file = new GeneratedFile(path);
+    project->generatedFiles.push_back(file);
+    return file;
+}
+
+bool ProjectGenerator::isSolutionWideProject(const GeneratedProject* project) const
+{
+    // those projects list files from all other projects so they must be generated after them
+    return project->mergedName == "_rtti_gen"
+        || project->originalProject->type == ProjectType::RttiGenerator
+        || project->originalProject->type == ProjectType::EmbeddedMedia;
+}
+
+bool ProjectGenerator::generateAutomaticCode(TaskPool& pool)
+{
+    ProfileScope profile("generateAutomaticCode");
+
+    // order in which the files and messages are reported, same as if projects were generated one by one
+    std::vector<GeneratedProject*> orderedProjects;
+    orderedProjects.reserve(projects.size());
 
-	for (auto* proj : projects)
-        if (proj->mergedName != "_rtti_gen")
-		    valid &= generateAutomaticCodeForProject(proj);
+    for (auto* proj : projects)
+        if (proj->mergedName != "_rtti_gen" && !proj->generated)
+            orderedProjects.push_back(proj);
 
     for (auto* proj : projects)
-        if (proj->mergedName == "_rtti_gen")
-            valid &= generateAutomaticCodeForProject(proj);
+        if (proj->mergedName == "_rtti_gen" && !proj->generated)
+            orderedProjects.push_back(proj);
+
+    // projects only write their own data so they can be generated in parallel
+    std::vector<uint32_t> localProjects;
+    for (uint32_t i = 0; i < orderedProjects.size(); ++i)
+        if (!isSolutionWideProject(orderedProjects[i]))
+            localProjects.push_back(i);
+
+    std::vector<uint8_t> results(orderedProjects.size(), 0);
+    pool.parallelFor((uint32_t)localProjects.size(), [this, &orderedProjects, &localProjects, &results](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            const auto projectIndex = localProjects[index];
+            results[projectIndex] = generateAutomaticCodeForProject(orderedProjects[projectIndex]);
+        });
+
+    for (uint32_t i = 0; i < orderedProjects.size(); ++i)
+        if (isSolutionWideProject(orderedProjects[i]))
+            results[i] = generateAutomaticCodeForProject(orderedProjects[i]);
+
+    bool valid = true;
+    for (uint32_t i = 0; i < orderedProjects.size(); ++i)
+    {
+        auto* proj = orderedProjects[i];
+        files.insert(files.end(), proj->generatedFiles.begin(), proj->generatedFiles.end());
+        proj->generatedFiles.clear();
+        proj->flushLog();
+
+        valid &= (results[i] != 0);
+    }
 
     return valid;
 }
 
-bool ProjectGenerator::generateExtraCode()
+bool ProjectGenerator::generateExtraCode(TaskPool& pool)
 {
-    bool valid = true;
+    ProfileScope profile("generateExtraCode");
 
-    for (auto* proj : projects)
-        valid &= generateExtraCodeForProject(proj);
+    std::vector<uint8_t> results(projects.size(), 1);
+    pool.parallelFor((uint32_t)projects.size(), [this, &results](uint32_t index, uint32_t /*workerIndex*/)
+        {
+            if (!projects[index]->generated)
+                results[index] = generateExtraCodeForProject(projects[index]);
+        });
+
+    bool valid = true;
+    for (uint32_t i = 0; i < projects.size(); ++i)
+    {
+        projects[i]->flushLog();
+        valid &= (results[i] != 0);
+    }
 
     return valid;    
 }
@@ -383,7 +724,7 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
             project->localReflectionFile = reflectionFilePath;
 
             // DO NOT WRITE as it's written by the reflection tool
-            //info->generatedFile = createFile(info->absolutePath);
+            //info->generatedFile = createProjectFile(project, info->absolutePath);
             //valid &= generateProjectDefaultReflection(project, info->generatedFile->content);
         }
     }
@@ -402,10 +743,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
                 info->type = ProjectFileType::CppHeader;
                 info->filterPath = "_generated";
                 info->name = project->mergedName + "_glue.inl";
-                info->generatedFile = createFile(info->absolutePath);
+                info->generatedFile = createProjectFile(project, info->absolutePath);
                 project->files.push_back(info);
 
                 valid &= generateProjectModuleGlueFile(project, sourceProject, info->generatedFile->content);
+                finishFile(info->generatedFile);
             }
         }
         else
@@ -418,10 +760,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
             info->type = ProjectFileType::CppHeader;
             info->filterPath = "_generated";
             info->name = project->mergedName + "_glue.inl";
-            info->generatedFile = createFile(info->absolutePath);
+            info->generatedFile = createProjectFile(project, info->absolutePath);
             project->files.push_back(info);
 
             valid &= generateProjectGlueFile(project, info->generatedFile->content);
+            finishFile(info->generatedFile);
         }
     }
 
@@ -432,10 +775,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
         info->type = ProjectFileType::CppHeader;
         info->filterPath = "_generated";
         info->name = "main.cpp";
-        info->generatedFile = createFile(info->absolutePath);
+        info->generatedFile = createProjectFile(project, info->absolutePath);
         project->files.push_back(info);
 
         valid &= generateProjectStaticInitFile(project, info->generatedFile->content);
+        finishFile(info->generatedFile);
     }
 
     if (project->originalProject->type == ProjectType::LocalApplication || project->originalProject->type == ProjectType::LocalLibrary)
@@ -448,10 +792,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
                 info->type = ProjectFileType::CppHeader;
                 info->filterPath = "_generated";
                 info->name = "build.h";
-                info->generatedFile = createFile(info->absolutePath);
+                info->generatedFile = createProjectFile(project, info->absolutePath);
                 project->files.push_back(info);
 
                 valid &= generateProjectBuildHeaderFile(project, info->generatedFile->content);
+                finishFile(info->generatedFile);
             }
 
             {
@@ -460,10 +805,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
                 info->type = ProjectFileType::CppSource;
                 info->filterPath = "_generated";
                 info->name = "build.cpp";
-                info->generatedFile = createFile(info->absolutePath);
+                info->generatedFile = createProjectFile(project, info->absolutePath);
                 project->files.push_back(info);
 
                 valid &= generateProjectBuildSourceFile(project, info->generatedFile->content);
+                finishFile(info->generatedFile);
             }
         }
     }
@@ -477,10 +823,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
             info->type = ProjectFileType::CppSource;
             info->filterPath = "_generated";
             info->name = "main.cpp";
-            info->generatedFile = createFile(info->absolutePath);
+            info->generatedFile = createProjectFile(project, info->absolutePath);
             project->files.push_back(info);
 
-            valid &= generateProjectMainSourceFile(project, info->generatedFile->content);            
+            valid &= generateProjectMainSourceFile(project, info->generatedFile->content);
+            finishFile(info->generatedFile);
         }
     }
 
@@ -491,10 +838,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
         info->type = ProjectFileType::MediaFileList;
         info->filterPath = "_generated";
         info->name = "media_list.txt";
-        info->generatedFile = createFile(info->absolutePath);
+        info->generatedFile = createProjectFile(project, info->absolutePath);
         project->files.push_back(info);
 
-        valid &= generateSolutionEmbeddFileList(info->generatedFile->content);
+        valid &= generateSolutionEmbeddFileList(project, info->generatedFile->content);
+        finishFile(info->generatedFile);
     }
 
 	if (project->originalProject->type == ProjectType::RttiGenerator)
@@ -504,10 +852,11 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
 		info->type = ProjectFileType::RTTIList;
 		info->filterPath = "_generated";
 		info->name = "rtti_list.txt";
-		info->generatedFile = createFile(info->absolutePath);
+		info->generatedFile = createProjectFile(project, info->absolutePath);
 		project->files.push_back(info);
 
-		valid &= generateSolutionReflectionFileList(info->generatedFile->content);
+		valid &= generateSolutionReflectionFileList(project, info->generatedFile->content);
+		finishFile(info->generatedFile);
 	}
 
     if (project->originalProject->type == ProjectType::LocalApplication || project->originalProject->type == ProjectType::LocalLibrary)
@@ -528,6 +877,12 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
         }
     }    
 
+    if (project->originalProject->type == ProjectType::LocalApplication || project->originalProject->type == ProjectType::LocalLibrary)
+    {
+        if (projectUsesUnityBuild(project))
+            valid &= generateProjectUnityFiles(project);
+    }
+
     for (const auto& externalIncludePath : project->originalProject->externalIncludePaths)
     {
         auto fullPath = config.engineRootPath / externalIncludePath;
@@ -549,7 +904,7 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
                         info->absolutePath.make_preferred();
                         info->filterPath = "_shared";
 
-                        std::cout << "Discovered shared file '" << info->absolutePath << "'\n";
+                        project->log << "Discovered shared file '" << info->absolutePath << "'\n";
 
                         info->name = name;
                         project->files.push_back(info);
@@ -562,13 +917,13 @@ bool ProjectGenerator::generateAutomaticCodeForProject(GeneratedProject* project
             }
             else
             {
-                std::cout << "No shared files found at shared directory '" << fullPath << "'\n";
+                project->log << "No shared files found at shared directory '" << fullPath << "'\n";
                 valid = false;
             }
         }
         catch (fs::filesystem_error& e)
         {
-            std::cout << "Filesystem Error: " << e.what() << "\n";
+            project->log << "Filesystem Error: " << e.what() << "\n";
         }
     }
 
@@ -602,7 +957,7 @@ bool ProjectGenerator::generateExtraCodeForProject(GeneratedProject* project)
     return valid;
 }
 
-bool ProjectGenerator::generateProjectModuleGlueFile(const GeneratedProject* project, const ProjectStructure::ProjectInfo* sourceProject, std::stringstream& f)
+bool ProjectGenerator::generateProjectModuleGlueFile(const GeneratedProject* project, const ProjectStructure::ProjectInfo* sourceProject, StringBuilder& f)
 {
     auto macroName = ToUpper(sourceProject->mergedName) + "_GLUE";
     auto apiName = ToUpper(sourceProject->mergedName) + "_API";
@@ -652,7 +1007,7 @@ bool ProjectGenerator::generateProjectModuleGlueFile(const GeneratedProject* pro
     return true;
 }
 
-bool ProjectGenerator::generateProjectGlueFile(const GeneratedProject* project, std::stringstream& f)
+bool ProjectGenerator::generateProjectGlueFile(const GeneratedProject* project, StringBuilder& f)
 {
     auto macroName = ToUpper(project->mergedName) + "_GLUE";
     auto apiName = ToUpper(project->mergedName) + "_API";
@@ -696,7 +1051,7 @@ bool ProjectGenerator::generateProjectGlueFile(const GeneratedProject* project,
     return true;
 }
 
-bool ProjectGenerator::generateProjectDefaultReflection(const GeneratedProject* project, std::stringstream& f)
+bool ProjectGenerator::generateProjectDefaultReflection(const GeneratedProject* project, StringBuilder& f)
 {
     writeln(f, "/// Inferno Engine v4 by Tomasz \"RexDex\" Jonarski");
     writeln(f, "/// RTTI Glue Code Generator is under MIT License");
@@ -705,7 +1060,7 @@ bool ProjectGenerator::generateProjectDefaultReflection(const GeneratedProject*
     return true;
 }
 
-bool ProjectGenerator::generateProjectMainSourceFile(const GeneratedProject* project, std::stringstream& f)
+bool ProjectGenerator::generateProjectMainSourceFile(const GeneratedProject* project, StringBuilder& f)
 {
     writeln(f, "/***");
     writeln(f, "* Inferno Engine Static Lib Initialization Code");
@@ -789,7 +1144,7 @@ bool ProjectGenerator::generateProjectMainSourceFile(const GeneratedProject* pro
     return true;
 }
 
-bool ProjectGenerator::generateProjectBuildSourceFile(const GeneratedProject* project, std::stringstream& f)
+bool ProjectGenerator::generateProjectBuildSourceFile(const GeneratedProject* project, StringBuilder& f)
 {
     writeln(f, "/***");
     writeln(f, "* Inferno Engine Static Lib Initialization Code");
@@ -852,7 +1207,7 @@ bool ProjectGenerator::generateProjectBuildSourceFile(const GeneratedProject* pr
     return true;
 }
 
-bool ProjectGenerator::generateProjectBuildHeaderFile(const GeneratedProject* project, std::stringstream& f)
+bool ProjectGenerator::generateProjectBuildHeaderFile(const GeneratedProject* project, StringBuilder& f)
 {
     writeln(f, "/***");
     writeln(f, "* Inferno Engine Static Lib Initialization Code");
@@ -892,6 +1247,15 @@ bool ProjectGenerator::generateProjectBuildHeaderFile(const GeneratedProject* pr
         if (file->name == "public.h")
             writeln(f, "#include \"" + file->absolutePath.u8string() + "\"");
 
+    if (!project->automaticPchIncludes.empty())
+    {
+        writeln(f, "");
+        writeln(f, "// Stable headers included by most of the project's sources:");
+
+        for (const auto& include : project->automaticPchIncludes)
+            writeln(f, "#include " + include);
+    }
+
     if (project->originalProject->hasTests)
     {
         writeln(f, "");
@@ -905,6 +1269,126 @@ bool ProjectGenerator::generateProjectBuildHeaderFile(const GeneratedProject* pr
     return true;
 }
 
+static const uint64_t UNITY_FILE_SOURCE_SIZE = 256 * 1024; // amount of source code (in bytes) to batch into a single unity file
+
+static bool CanBatchIntoUnityFile(const ProjectGenerator::GeneratedProjectFile* file)
+{
+    if (!file->originalFile || !file->useInCurrentBuild || file->type != ProjectFileType::CppSource)
+        return false;
+
+    if (!file->originalFile->flagUsePch || file->originalFile->flagNoUnity)
+        return false;
+
+    // main files and C sources are compiled with different settings
+    if (file->name == "main.cpp" || file->absolutePath.extension() != ".cpp")
+        return false;
+
+    return true;
+}
+
+bool ProjectGenerator::generateProjectUnityFiles(GeneratedProject* project)
+{
+    std::vector<GeneratedProjectFile*> sources;
+    std::vector<uint64_t> sourceSizes;
+    uint64_t totalSize = 0;
+
+    for (auto* file : project->files)
+    {
+        if (CanBatchIntoUnityFile(file))
+        {
+            std::error_code ec;
+            const auto size = fs::file_size(file->absolutePath, ec);
+
+            sources.push_back(file);
+            sourceSizes.push_back(ec ? 0 : (uint64_t)size);
+            totalSize += sourceSizes.back();
+        }
+    }
+
+    // nothing to gain from batching a single file
+    if (sources.size() < 2)
+        return true;
+
+    const auto numUnityFiles = (uint32_t)std::clamp<uint64_t>((totalSize + UNITY_FILE_SOURCE_SIZE - 1) / UNITY_FILE_SOURCE_SIZE, 1, sources.size() / 2);
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < sources.size(); ++i)
+        order.push_back(i);
+
+    std::stable_sort(order.begin(), order.end(), [&sourceSizes](uint32_t a, uint32_t b) { return sourceSizes[a] > sourceSizes[b]; });
+
+    // biggest files go first, each file is added to the smallest batch so far
+    std::vector<std::vector<uint32_t>> batches(numUnityFiles);
+    std::vector<uint64_t> batchSizes(numUnityFiles, 0);
+    for (const auto index : order)
+    {
+        const auto batchIndex = std::min_element(batchSizes.begin(), batchSizes.end()) - batchSizes.begin();
+        batches[batchIndex].push_back(index);
+        batchSizes[batchIndex] += std::max<uint64_t>(1, sourceSizes[index]);
+    }
+
+    bool valid = true;
+    for (uint32_t i = 0; i < numUnityFiles; ++i)
+    {
+        // keep the project order of files inside of the batch so the output is stable
+        auto& batch = batches[i];
+        std::sort(batch.begin(), batch.end());
+
+        std::vector<const GeneratedProjectFile*> batchSources;
+        for (const auto index : batch)
+        {
+            sources[index]->unityBatched = true;
+            batchSources.push_back(sources[index]);
+        }
+
+        const auto name = "unity_" + std::to_string(i) + ".cpp";
+
+        auto* info = new GeneratedProjectFile;
+        info->absolutePath = project->generatedPath / name;
+        info->type = ProjectFileType::CppSource;
+        info->filterPath = "_generated";
+        info->name = name;
+        info->unityFile = true;
+        info->generatedFile = createProjectFile(project, info->absolutePath);
+        project->files.push_back(info);
+
+        valid &= generateProjectUnityFile(project, batchSources, info->generatedFile->content);
+        finishFile(info->generatedFile);
+    }
+
+    project->log << "Batched " << sources.size() << " source files of '" << project->mergedName << "' into " << numUnityFiles << " unity file(s)\n";
+    return valid;
+}
+
+bool ProjectGenerator::generateProjectUnityFile(const GeneratedProject* project, const std::vector<const GeneratedProjectFile*>& sources, StringBuilder& f)
+{
+    writeln(f, "/***");
+    writeln(f, "* Inferno Engine Unity Build File");
+    writeln(f, "* Auto generated, do not modify");
+    writeln(f, "* Build system source code licensed under MIP license");
+    writeln(f, "***/");
+    writeln(f, "");
+
+    if (project->originalProject->flagUsePCH)
+    {
+        writeln(f, "#include \"build.h\"");
+        writeln(f, "");
+    }
+
+    for (const auto* file : sources)
+        writelnf(f, "#include \"%s\"", MakeGenericPath(file->absolutePath.u8string()).c_str());
+
+    return true;
+}
+
+bool ProjectGenerator::projectUsesUnityBuild(const GeneratedProject* project) const
+{
+    if (project->originalProject->flagNoUnity)
+        return false;
+
+    return project->originalProject->flagUnity || config.unity;
+}
+
 bool ProjectGenerator::projectRequiresStaticInit(const GeneratedProject* project) const
 {
     if (project->originalProject->flagNoInit)
@@ -923,7 +1407,7 @@ bool ProjectGenerator::projectRequiresStaticInit(const GeneratedProject* project
     return project->mergedName == "core_system";
 }
 
-bool ProjectGenerator::generateProjectStaticInitFile(const GeneratedProject* project, std::stringstream& f)
+bool ProjectGenerator::generateProjectStaticInitFile(const GeneratedProject* project, StringBuilder& f)
 {
     writeln(f, "/***");
     writeln(f, "* Inferno Engine Static Lib Initialization Code");
@@ -1022,7 +1506,7 @@ bool ProjectGenerator::generateProjectStaticInitFile(const GeneratedProject* pro
     return true;
 }
 
-bool ProjectGenerator::generateSolutionReflectionFileList(std::stringstream& f)
+bool ProjectGenerator::generateSolutionReflectionFileList(GeneratedProject* project, StringBuilder& f)
 {
     writeln(f, NameEnumOption(config.platform));
     writeln(f, NameEnumOption(config.build));
@@ -1044,7 +1528,7 @@ bool ProjectGenerator::generateSolutionReflectionFileList(std::stringstream& f)
 
             for (const auto* file : proj->files)
             {
-                if (file->type == ProjectFileType::CppSource)
+                if (file->type == ProjectFileType::CppSource && !file->unityFile)
                 {
                     writelnf(f, "%hs", file->absolutePath.u8string().c_str());
                     numReflectedFiles += 1;
@@ -1053,11 +1537,11 @@ bool ProjectGenerator::generateSolutionReflectionFileList(std::stringstream& f)
         }
     }
 
-    std::cout << "Found " << numReflectedFiles << " source code files for reflection of (" << numTotalFiles << " total)\n";
+    project->log << "Found " << numReflectedFiles << " source code files for reflection of (" << numTotalFiles << " total)\n";
     return true;
 }
 
-bool ProjectGenerator::generateSolutionEmbeddFileList(std::stringstream& f)
+bool ProjectGenerator::generateSolutionEmbeddFileList(GeneratedProject* project, StringBuilder& f)
 {
 	writeln(f, NameEnumOption(config.platform));
 
@@ -1084,7 +1568,7 @@ bool ProjectGenerator::generateSolutionEmbeddFileList(std::stringstream& f)
 		}
 	}
 
-	std::cout << "Found " << numMediaFiles << " embedded media build files\n";
+	project->log << "Found " << numMediaFiles << " embedded media build files\n";
 	return true;
 }
 
@@ -1095,7 +1579,7 @@ bool ProjectGenerator::processBisonFile(GeneratedProject* project, const Generat
     auto* tool = project->originalProject->findToolByName("bison");
     if (!tool)
     {
-        std::cout << "BISON library not linked by current project\n";
+        project->log << "BISON library not linked by current project\n";
         return false;
     }
 
@@ -1120,7 +1604,7 @@ bool ProjectGenerator::processBisonFile(GeneratedProject* project, const Generat
         {
             if (!fs::create_directories(project->generatedPath, ec))
             {
-                std::cout << "BISON tool failed because output directory \"" << project->generatedPath << "\" can't be created: " << ec << "\n";
+                project->log << "BISON tool failed because output directory \"" << project->generatedPath << "\" can't be created: " << ec << "\n";
                 return false;
             }
         }
@@ -1133,6 +1617,9 @@ bool ProjectGenerator::processBisonFile(GeneratedProject* project, const Generat
         params << "--report-file=\"" << reportPath.u8string() << "\" ";
         params << "--verbose";
 
+        // working directory is shared by the whole process, only one tool can be run at a time
+        std::unique_lock<std::mutex> lock(GToolDirectoryLock);
+
         const auto activeDir = fs::current_path();
         const auto bisonDir = tool->executablePath.parent_path();
         fs::current_path(bisonDir);
@@ -1140,20 +1627,21 @@ bool ProjectGenerator::processBisonFile(GeneratedProject* project, const Generat
         auto code = std::system(params.str().c_str());
 
         fs::current_path(activeDir);
+        lock.unlock();
 
         if (code != 0)
         {
-            std::cout << "BISON tool failed with exit code " << code << "\n";
+            project->log << "BISON tool failed with exit code " << code << "\n";
             return false;
         }
         else
         {
-            std::cout << "BISON tool finished and generated '" << parserFile << "'\n";
+            project->log << "BISON tool finished and generated '" << parserFile << "'\n";
         }
     }
     else
     {
-        std::cout << "BISON tool skipped because '" << parserFile << "' is up to date\n";
+        project->log << "BISON tool skipped because '" << parserFile << "' is up to date\n";
     }
 
     {
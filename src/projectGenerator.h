@@ -16,16 +16,37 @@ struct FileGenerator
         fs::path absolutePath;
         fs::file_time_type customtTime;
 
-        std::stringstream content; // may be empty
+        StringBuilder content; // may be empty, released once the file is saved in the streaming mode
+
+        bool saved = false; // file was already saved, content can't be changed any more
+        bool saveResult = false;
+        uint32_t saveCount = 0; // 1 if the file had to be written
+        std::string saveLog; // messages from saving, reported in the order of files
     };
 
     GeneratedFile* createFile(const fs::path& path);
 
-    bool saveFiles();
+    // called once the content of the file is complete, in the streaming mode the file is saved right away and its content is released
+    void finishFile(GeneratedFile* file);
+
+    // save all files not saved yet and report results for all of the files
+    bool saveFiles(TaskPool& pool);
 
     //--
 
     std::vector<GeneratedFile*> files; // may be empty
+
+    fs::path manifestPath; // optional, records saved outputs so unchanged files can be confirmed without reading them back
+
+    bool streaming = false; // save files as they are finished instead of keeping all of them in memory until saveFiles
+
+private:
+    OutputManifest m_manifest;
+    std::once_flag m_manifestLoaded;
+
+    OutputManifest* manifest(); // loaded on first use, null if not used
+
+    void saveFile(GeneratedFile* file);
 };
 
 //--
@@ -44,6 +65,8 @@ struct ProjectGenerator : public FileGenerator
         ProjectFileType type = ProjectFileType::Unknown;
 
         bool useInCurrentBuild = true;
+        bool unityBatched = false; // compiled as a part of one of the project's unity files instead of on its own
+        bool unityFile = false; // generated file including a batch of the project's sources
 
         fs::path absolutePath; // location
     };
@@ -88,8 +111,16 @@ struct ProjectGenerator : public FileGenerator
 
         std::vector<GeneratedProjectFile*> files; // may be empty
         std::vector<fs::path> additionalIncludePaths;
+        std::vector<std::string> automaticPchIncludes; // extra build.h includes picked from the include statistics, "<vector>" or "\"path\""
 
         std::string assignedVSGuid;
+
+        bool generated = false; // files were generated in one of the previous rounds of the watch mode, only refreshed projects are generated again
+
+        std::vector<GeneratedFile*> generatedFiles; // files created while the project was generated, moved to the global list in project order
+        std::stringstream log; // messages produced while the project is generated on a worker thread
+
+        void flushLog();
     };
 
     struct ScriptProject
@@ -106,9 +137,15 @@ struct ProjectGenerator : public FileGenerator
 
     bool extractProjects(const ProjectStructure& structure);
 
-    bool generateAutomaticCode();
+    // watch mode, replaces the projects of the changed structure projects (by name) and all projects using them, only those are generated again
+    bool refreshProjects(const ProjectStructure& structure, const std::unordered_set<std::string>& changedProjects);
+
+    // drops the saved files and marks all projects as generated, the projects are kept for the next refresh
+    void releaseFiles();
 
-    bool generateExtraCode(); // tools
+    bool generateAutomaticCode(TaskPool& pool);
+
+    bool generateExtraCode(TaskPool& pool); // tools
 
     GeneratedGroup* createGroup(std::string_view name);
 
@@ -136,23 +173,33 @@ private:
 
     //-
 
+    GeneratedProject* createProject(const ProjectStructure::ProjectInfo* proj); // null if the project is not used in current build
+    bool linkProjects(const ProjectStructure& structure);
+
+    GeneratedFile* createProjectFile(GeneratedProject* project, const fs::path& path);
+
+    bool isSolutionWideProject(const GeneratedProject* project) const;
+
     bool generateAutomaticCodeForProject(GeneratedProject* project);
     bool generateExtraCodeForProject(GeneratedProject* project);
 
     bool processBisonFile(GeneratedProject* project, const GeneratedProjectFile* file);
 
-    bool generateProjectGlueFile(const GeneratedProject* project, std::stringstream& outContent);
-    bool generateProjectModuleGlueFile(const GeneratedProject* project, const ProjectStructure::ProjectInfo* sourceProject, std::stringstream& outContent);
-    bool generateProjectStaticInitFile(const GeneratedProject* project, std::stringstream& outContent);
-    bool generateProjectDefaultReflection(const GeneratedProject* project, std::stringstream& outContent);
-    bool generateProjectBuildSourceFile(const GeneratedProject* project, std::stringstream& outContent);
-    bool generateProjectMainSourceFile(const GeneratedProject* project, std::stringstream& outContent);
-    bool generateProjectBuildHeaderFile(const GeneratedProject* project, std::stringstream& outContent);
+    bool generateProjectGlueFile(const GeneratedProject* project, StringBuilder& outContent);
+    bool generateProjectModuleGlueFile(const GeneratedProject* project, const ProjectStructure::ProjectInfo* sourceProject, StringBuilder& outContent);
+    bool generateProjectStaticInitFile(const GeneratedProject* project, StringBuilder& outContent);
+    bool generateProjectDefaultReflection(const GeneratedProject* project, StringBuilder& outContent);
+    bool generateProjectBuildSourceFile(const GeneratedProject* project, StringBuilder& outContent);
+    bool generateProjectMainSourceFile(const GeneratedProject* project, StringBuilder& outContent);
+    bool generateProjectBuildHeaderFile(const GeneratedProject* project, StringBuilder& outContent);
+    bool generateProjectUnityFiles(GeneratedProject* project);
+    bool generateProjectUnityFile(const GeneratedProject* project, const std::vector<const GeneratedProjectFile*>& sources, StringBuilder& outContent);
 
-    bool generateSolutionEmbeddFileList(std::stringstream& outContent);
-    bool generateSolutionReflectionFileList(std::stringstream& outContent);
+    bool generateSolutionEmbeddFileList(GeneratedProject* project, StringBuilder& outContent);
+    bool generateSolutionReflectionFileList(GeneratedProject* project, StringBuilder& outContent);
 
     bool projectRequiresStaticInit(const GeneratedProject* project) const;
+    bool projectUsesUnityBuild(const GeneratedProject* project) const;
 
     bool shouldUseFile(const ProjectStructure::FileInfo* file) const;
 
@@ -0,0 +1,487 @@
+#include "common.h"
+#include "project.h"
+#include "profiler.h"
+
+//--
+
+static const uint32_t SNAPSHOT_MAGIC = 0x534E4C42; // "BLNS"
+static const uint32_t SNAPSHOT_VERSION = 4;
+
+static const uint32_t SNAPSHOT_CHECK_BATCH = 64; // directories checked by a single task
+
+static void WriteStrings(BinaryWriter& w, const std::vector<std::string>& list)
+{
+    w.writeUint32((uint32_t)list.size());
+    for (const auto& str : list)
+        w.writeString(str);
+}
+
+static void ReadStrings(BinaryReader& r, std::vector<std::string>& outList)
+{
+    const auto count = r.readUint32();
+    for (uint32_t i = 0; i < count && r.valid(); ++i)
+        outList.push_back(r.readString());
+}
+
+static void WritePaths(BinaryWriter& w, const std::vector<fs::path>& list)
+{
+    w.writeUint32((uint32_t)list.size());
+    for (const auto& path : list)
+        w.writePath(path);
+}
+
+static void ReadPaths(BinaryReader& r, std::vector<fs::path>& outList)
+{
+    const auto count = r.readUint32();
+    for (uint32_t i = 0; i < count && r.valid(); ++i)
+        outList.push_back(r.readPath());
+}
+
+static void WriteDefines(BinaryWriter& w, const std::vector<std::pair<std::string, std::string>>& list)
+{
+    w.writeUint32((uint32_t)list.size());
+    for (const auto& define : list)
+    {
+        w.writeString(define.first);
+        w.writeString(define.second);
+    }
+}
+
+static void ReadDefines(BinaryReader& r, std::vector<std::pair<std::string, std::string>>& outList)
+{
+    const auto count = r.readUint32();
+    for (uint32_t i = 0; i < count && r.valid(); ++i)
+    {
+        auto name = r.readString();
+        auto value = r.readString();
+        outList.emplace_back(std::move(name), std::move(value));
+    }
+}
+
+static void WriteDeployList(BinaryWriter& w, const std::vector<ProjectStructure::DeployInfo>& list)
+{
+    w.writeUint32((uint32_t)list.size());
+    for (const auto& deploy : list)
+    {
+        w.writePath(deploy.sourcePath);
+        w.writeString(deploy.deployTarget);
+    }
+}
+
+static void ReadDeployList(BinaryReader& r, std::vector<ProjectStructure::DeployInfo>& outList)
+{
+    const auto count = r.readUint32();
+    for (uint32_t i = 0; i < count && r.valid(); ++i)
+    {
+        ProjectStructure::DeployInfo deploy;
+        deploy.sourcePath = r.readPath();
+        deploy.deployTarget = r.readString();
+        outList.push_back(std::move(deploy));
+    }
+}
+
+//--
+
+static void WriteFile(BinaryWriter& w, const ProjectStructure::FileInfo& file)
+{
+    w.writeUint8((uint8_t)file.type);
+    w.writeUint8((uint8_t)file.filter);
+    w.writeString(file.name);
+    w.writeUint8(file.flagUsePch);
+    w.writeUint8(file.flagNoWarnings);
+    w.writeUint8(file.flagWarn3);
+    w.writeUint8(file.flagExcluded);
+    w.writeUint8(file.flagNoUnity);
+    w.writeUint8(file.flagVolatile);
+    w.writeString(file.projectRelativePath);
+    w.writeString(file.rootRelativePath);
+    w.writePath(file.absolutePath);
+}
+
+static void ReadFile(BinaryReader& r, ProjectStructure::FileInfo& file)
+{
+    file.type = (ProjectFileType)r.readUint8();
+    file.filter = (ProjectFilePlatformFilter)r.readUint8();
+    file.name = r.readString();
+    file.flagUsePch = r.readUint8() != 0;
+    file.flagNoWarnings = r.readUint8() != 0;
+    file.flagWarn3 = r.readUint8() != 0;
+    file.flagExcluded = r.readUint8() != 0;
+    file.flagNoUnity = r.readUint8() != 0;
+    file.flagVolatile = r.readUint8() != 0;
+    file.projectRelativePath = r.readString();
+    file.rootRelativePath = r.readString();
+    file.absolutePath = r.readPath();
+}
+
+static void WriteProject(BinaryWriter& w, const ProjectStructure::ProjectInfo& project, uint32_t groupIndex)
+{
+    w.writeUint32(groupIndex);
+    w.writeString(project.name);
+    w.writeString(project.mergedName);
+    w.writePath(project.rootPath);
+    w.writeUint64(project.scriptHash);
+
+    w.writeUint8(project.hasScriptErrors);
+    w.writeUint8(project.hasTests);
+    w.writeUint8(project.hasMedia);
+
+    w.writeUint8(project.flagNoInit);
+    w.writeUint8(project.flagNoWarnings);
+    w.writeUint8(project.flagWarn3);
+    w.writeUint8(project.flagUsePCH);
+    w.writeUint8(project.flagConsole);
+    w.writeUint8(project.flagDevOnly);
+    w.writeUint8(project.flagNoSymbols);
+    w.writeUint8(project.flagForceSharedLibrary);
+    w.writeUint8(project.flagForceStaticLibrary);
+    w.writeUint8(project.flagPureDynamicLibrary);
+    w.writeUint8(project.flagGlobalInclude);
+    w.writeUint8(project.flagModuleRoot);
+    w.writeUint8(project.flagGenerateMain);
+    w.writeUint8(project.flagAllowExceptions);
+    w.writeUint8(project.flagUnity);
+    w.writeUint8(project.flagNoUnity);
+    w.writeUint8(project.flagNoAutoPch);
+
+    w.writeString(project.moduleName);
+    w.writeUint8((uint8_t)project.type);
+    w.writeUint8((uint8_t)project.filter);
+
+    WriteStrings(w, project.dependencies);
+    WriteStrings(w, project.optionalDependencies);
+    WriteStrings(w, project.localIncludeDirectories);
+    WriteDefines(w, project.localDefines);
+    WriteDefines(w, project.globalDefines);
+    WritePaths(w, project.libraryInlcudePaths);
+    WritePaths(w, project.libraryLinkFile);
+    WriteDeployList(w, project.deployList);
+    WriteDeployList(w, project.sharedDeployList);
+    WriteStrings(w, project.externalIncludePaths);
+
+    w.writeUint32((uint32_t)project.probedPaths.size());
+    for (const auto& probed : project.probedPaths)
+    {
+        w.writePath(probed.first);
+        w.writeTime(probed.second);
+    }
+
+    w.writeString(project.appClassName);
+    w.writeString(project.appHeaderName);
+
+    w.writeUint32((uint32_t)project.tools.size());
+    for (const auto& tool : project.tools)
+    {
+        w.writeString(tool.name);
+        w.writePath(tool.executablePath);
+    }
+
+    w.writeString(project.assignedVSGuid);
+    w.writeString(project.assignedProjectFile);
+
+    w.writeUint32((uint32_t)project.files.size());
+    for (const auto* file : project.files)
+        WriteFile(w, *file);
+}
+
+static void ReadProject(BinaryReader& r, ProjectStructure::ProjectInfo& project)
+{
+    project.name = r.readString();
+    project.mergedName = r.readString();
+    project.rootPath = r.readPath();
+    project.scriptHash = r.readUint64();
+
+    project.hasScriptErrors = r.readUint8() != 0;
+    project.hasTests = r.readUint8() != 0;
+    project.hasMedia = r.readUint8() != 0;
+
+    project.flagNoInit = r.readUint8() != 0;
+    project.flagNoWarnings = r.readUint8() != 0;
+    project.flagWarn3 = r.readUint8() != 0;
+    project.flagUsePCH = r.readUint8() != 0;
+    project.flagConsole = r.readUint8() != 0;
+    project.flagDevOnly = r.readUint8() != 0;
+    project.flagNoSymbols = r.readUint8() != 0;
+    project.flagForceSharedLibrary = r.readUint8() != 0;
+    project.flagForceStaticLibrary = r.readUint8() != 0;
+    project.flagPureDynamicLibrary = r.readUint8() != 0;
+    project.flagGlobalInclude = r.readUint8() != 0;
+    project.flagModuleRoot = r.readUint8() != 0;
+    project.flagGenerateMain = r.readUint8() != 0;
+    project.flagAllowExceptions = r.readUint8() != 0;
+    project.flagUnity = r.readUint8() != 0;
+    project.flagNoUnity = r.readUint8() != 0;
+    project.flagNoAutoPch = r.readUint8() != 0;
+
+    project.moduleName = r.readString();
+    project.type = (ProjectType)r.readUint8();
+    project.filter = (ProjectFilePlatformFilter)r.readUint8();
+
+    ReadStrings(r, project.dependencies);
+    ReadStrings(r, project.optionalDependencies);
+    ReadStrings(r, project.localIncludeDirectories);
+    ReadDefines(r, project.localDefines);
+    ReadDefines(r, project.globalDefines);
+    ReadPaths(r, project.libraryInlcudePaths);
+    ReadPaths(r, project.libraryLinkFile);
+    ReadDeployList(r, project.deployList);
+    ReadDeployList(r, project.sharedDeployList);
+    ReadStrings(r, project.externalIncludePaths);
+
+    const auto numProbedPaths = r.readUint32();
+    for (uint32_t i = 0; i < numProbedPaths && r.valid(); ++i)
+    {
+        auto path = r.readPath();
+        auto time = r.readTime();
+        project.probedPaths.emplace_back(std::move(path), time);
+    }
+
+    project.appClassName = r.readString();
+    project.appHeaderName = r.readString();
+
+    const auto numTools = r.readUint32();
+    for (uint32_t i = 0; i < numTools && r.valid(); ++i)
+    {
+        ProjectStructure::ToolInfo tool;
+        tool.name = r.readString();
+        tool.executablePath = r.readPath();
+        project.tools.push_back(std::move(tool));
+    }
+
+    project.assignedVSGuid = r.readString();
+    project.assignedProjectFile = r.readString();
+
+    const auto numFiles = r.readUint32();
+    for (uint32_t i = 0; i < numFiles && r.valid(); ++i)
+    {
+        auto* file = new ProjectStructure::FileInfo;
+        ReadFile(r, *file);
+        file->originalProject = &project;
+        project.files.push_back(file);
+
+        // media files are not looked up by path
+        if (file->type != ProjectFileType::MediaFile && file->type != ProjectFileType::MediaScript)
+            project.filesMapByRelativePath[file->projectRelativePath] = file;
+    }
+}
+
+//--
+
+static void WriteHeader(BinaryWriter& w, const Configuration& config)
+{
+    w.writeUint32(SNAPSHOT_MAGIC);
+    w.writeUint32(SNAPSHOT_VERSION);
+    w.writeTime(GetFileTime(config.builderExecutablePath));
+    w.writeString(config.mergedName());
+    w.writePath(config.engineSourcesPath);
+    w.writePath(config.projectSourcesPath);
+}
+
+static bool CheckHeader(BinaryReader& r, const Configuration& config, std::string& outReason)
+{
+    if (r.readUint32() != SNAPSHOT_MAGIC || r.readUint32() != SNAPSHOT_VERSION)
+    {
+        outReason = "incompatible format";
+        return false;
+    }
+
+    if (r.readTime() != GetFileTime(config.builderExecutablePath))
+    {
+        outReason = "builder executable has changed";
+        return false;
+    }
+
+    if (r.readString() != config.mergedName())
+    {
+        outReason = "configuration has changed";
+        return false;
+    }
+
+    if (r.readPath() != config.engineSourcesPath || r.readPath() != config.projectSourcesPath)
+    {
+        outReason = "source paths have changed";
+        return false;
+    }
+
+    return r.valid();
+}
+
+//--
+
+void ProjectStructure::writeSnapshot(BinaryWriter& w, const Configuration& config) const
+{
+    WriteHeader(w, config);
+
+    w.writeUint32((uint32_t)scannedDirectories.size());
+    for (const auto& dir : scannedDirectories)
+    {
+        w.writePath(dir.first);
+        w.writeTime(dir.second);
+    }
+
+    w.writeUint32((uint32_t)groups.size());
+    for (const auto* group : groups)
+    {
+        w.writeUint8((uint8_t)group->type);
+        w.writePath(group->rootPath);
+    }
+
+    // the special projects added by the generation are not part of the scanned structure
+    std::vector<const ProjectInfo*> scannedProjects;
+    for (const auto* project : projects)
+        if (project->type != ProjectType::RttiGenerator && project->type != ProjectType::EmbeddedMedia)
+            scannedProjects.push_back(project);
+
+    w.writeUint32((uint32_t)scannedProjects.size());
+    for (const auto* project : scannedProjects)
+    {
+        const auto groupIndex = std::find(groups.begin(), groups.end(), project->group) - groups.begin();
+        WriteProject(w, *project, (uint32_t)groupIndex);
+    }
+}
+
+bool ProjectStructure::saveSnapshot(const fs::path& path, const Configuration& config, std::ostream& log) const
+{
+    ProfileScope profile("saveSnapshot");
+
+    BinaryWriter w;
+    writeSnapshot(w, config);
+    return SaveBinaryFile(path, w.data(), log);
+}
+
+bool ProjectStructure::loadSnapshot(const fs::path& path, const Configuration& config, TaskPool& pool)
+{
+    ProfileScope profile("loadSnapshot");
+
+    FileView data;
+    if (!data.open(path))
+        return false;
+
+    if (!readSnapshot(data.view(), config, pool, true))
+        return false;
+
+    std::cout << "Loaded project structure snapshot with " << projects.size() << " project(s)\n";
+    return true;
+}
+
+bool ProjectStructure::readSnapshot(std::string_view data, const Configuration& config, TaskPool& pool, bool validate)
+{
+    BinaryReader r(data);
+
+    std::string reason;
+    if (!CheckHeader(r, config, reason))
+    {
+        if (!reason.empty())
+            std::cout << "Project structure snapshot is out of date (" << reason << "), rescanning\n";
+        return false;
+    }
+
+    std::vector<std::pair<fs::path, fs::file_time_type>> directories;
+    {
+        const auto count = r.readUint32();
+        for (uint32_t i = 0; i < count && r.valid(); ++i)
+        {
+            auto dirPath = r.readPath();
+            auto dirTime = r.readTime();
+            directories.emplace_back(std::move(dirPath), dirTime);
+        }
+    }
+
+    std::vector<ProjectGroup*> loadedGroups;
+    {
+        const auto count = r.readUint32();
+        for (uint32_t i = 0; i < count && r.valid(); ++i)
+        {
+            auto* group = new ProjectGroup;
+            group->type = (ProjectGroupType)r.readUint8();
+            group->rootPath = r.readPath();
+            loadedGroups.push_back(group);
+        }
+    }
+
+    std::vector<ProjectInfo*> loadedProjects;
+    {
+        const auto count = r.readUint32();
+        for (uint32_t i = 0; i < count && r.valid(); ++i)
+        {
+            const auto groupIndex = r.readUint32();
+            if (groupIndex >= loadedGroups.size())
+                break;
+
+            auto* project = new ProjectInfo;
+            project->group = loadedGroups[groupIndex];
+            ReadProject(r, *project);
+
+            project->group->projects.push_back(project);
+            loadedProjects.push_back(project);
+        }
+
+        if (loadedProjects.size() != count)
+            reason = "corrupted data";
+    }
+
+    // any added or removed file or directory changes the modification time of the parent directory
+    // the scripts are checked by content since editors tend to touch the files without changing them
+    // files and directories the scripts looked at outside of the scan (libraries, tools) are checked by time, missing ones have an empty time
+    if (reason.empty() && r.valid() && validate)
+    {
+        const auto numDirBatches = (uint32_t)((directories.size() + SNAPSHOT_CHECK_BATCH - 1) / SNAPSHOT_CHECK_BATCH);
+        std::vector<uint8_t> results(numDirBatches + loadedProjects.size(), true);
+
+        pool.parallelFor((uint32_t)results.size(), [&directories, &loadedProjects, &results, numDirBatches](uint32_t index, uint32_t /*workerIndex*/) {
+            if (index < numDirBatches)
+            {
+                const auto first = index * SNAPSHOT_CHECK_BATCH;
+                const auto last = std::min<size_t>(first + SNAPSHOT_CHECK_BATCH, directories.size());
+                for (auto i = first; i < last; ++i)
+                    if (GetFileTime(directories[i].first) != directories[i].second)
+                        results[index] = false;
+            }
+            else
+            {
+                const auto* project = loadedProjects[index - numDirBatches];
+
+                FileView code;
+                if (!code.open(project->rootPath / "build.lua") || HashContent(code.view()) != project->scriptHash)
+                    results[index] = false;
+
+                for (const auto& probed : project->probedPaths)
+                    if (GetFileTime(probed.first) != probed.second)
+                        results[index] = false;
+            }
+        });
+
+        const auto it = std::find(results.begin(), results.end(), false);
+        if (it != results.end())
+            reason = ((uint32_t)(it - results.begin()) < numDirBatches) ? "directories have changed" : "build scripts or the files they use have changed";
+    }
+    else if (reason.empty() && !r.valid())
+    {
+        reason = "corrupted data";
+    }
+
+    if (!reason.empty())
+    {
+        std::cout << "Project structure snapshot is out of date (" << reason << "), rescanning\n";
+
+        for (auto* project : loadedProjects)
+            delete project;
+        for (auto* group : loadedGroups)
+            delete group;
+
+        return false;
+    }
+
+    //--
+
+    groups = std::move(loadedGroups);
+    projects = std::move(loadedProjects);
+    scannedDirectories = std::move(directories);
+
+    for (auto* project : projects)
+        projectsMap[project->mergedName] = project;
+
+    return true;
+}
+
+//--
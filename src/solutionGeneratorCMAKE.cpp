@@ -2,6 +2,7 @@
 #include "project.h"
 #include "projectGenerator.h"
 #include "solutionGeneratorCMAKE.h"
+#include "profiler.h"
 
 SolutionGeneratorCMAKE::SolutionGeneratorCMAKE(const Configuration& config, ProjectGenerator& gen)
     : m_config(config)
@@ -11,12 +12,12 @@ SolutionGeneratorCMAKE::SolutionGeneratorCMAKE(const Configuration& config, Proj
     m_buildWithLibs = (config.libs == LibraryType::Static);
 }
 
-void SolutionGeneratorCMAKE::printSolutionDeclarations(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g)
+void SolutionGeneratorCMAKE::printSolutionDeclarations(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g)
 {
 
 }
 
-void SolutionGeneratorCMAKE::printSolutionParentLinks(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g)
+void SolutionGeneratorCMAKE::printSolutionParentLinks(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g)
 {
 
 }
@@ -38,16 +39,13 @@ static std::string EscapePath(fs::path path)
 {
     path.make_preferred();
 
-    std::stringstream ss;
-    ss << "\"";
-    ss << MakeGenericPath(path.u8string());
-    ss << "\"";
-
-    return ss.str();
+    return "\"" + MakeGenericPath(path.u8string()) + "\"";
 }
 
 bool SolutionGeneratorCMAKE::generateSolution()
 {
+    ProfileScope profile("generateSolution");
+
     auto* file = m_gen.createFile(m_config.solutionPath / "CMakeLists.txt");
     auto& f = file->content;
 
@@ -59,7 +57,7 @@ bool SolutionGeneratorCMAKE::generateSolution()
 
     writeln(f, "project(InfernoEngine)");
     writeln(f, "");
-    writeln(f, "cmake_minimum_required(VERSION 2.8.10)");
+    writeln(f, "cmake_minimum_required(VERSION 3.16)");
     writeln(f, "");
 
     //writeln(f, "#SET(CMAKE_C_COMPILER /usr/bin/gcc)");
@@ -86,40 +84,63 @@ bool SolutionGeneratorCMAKE::generateSolution()
     writeln(f, "include(OptimizeForArchitecture)"); // Praise OpenSource!
     writeln(f, "");
 
+    const auto windowsPlatform = (m_config.platform == PlatformType::Windows || m_config.platform == PlatformType::UWP);
+    if (m_config.pgo == ProfileGuidedStage::Optimize && !windowsPlatform)
+    {
+        const auto profilePath = MakeGenericPath(m_config.profilePath.u8string());
+
+        // GCC reads the .gcda files directly, Clang needs the raw profiles merged first
+        writeln(f, "if(CMAKE_CXX_COMPILER_ID MATCHES \"Clang\")");
+        writelnf(f, "  file(GLOB PGO_RAW_PROFILES \"%s/*.profraw\")", profilePath.c_str());
+        writeln(f, "  find_program(LLVM_PROFDATA NAMES llvm-profdata)");
+        writeln(f, "  if(PGO_RAW_PROFILES AND LLVM_PROFDATA)");
+        writelnf(f, "    execute_process(COMMAND ${LLVM_PROFDATA} merge \"-output=%s/default.profdata\" ${PGO_RAW_PROFILES})", profilePath.c_str());
+        writeln(f, "  endif()");
+        writeln(f, "endif()");
+        writeln(f, "");
+    }
+
     for (const auto* p : m_gen.projects)
         if (p->originalProject->type == ProjectType::LocalLibrary || p->originalProject->type == ProjectType::LocalApplication)
             writelnf(f, "add_subdirectory(%s)", EscapePath(p->generatedPath).c_str());
 
+    m_gen.finishFile(file);
     return true;
 }
 
 bool SolutionGeneratorCMAKE::generateProjects()
 {
+    ProfileScope profile("generateProjects");
+
     bool valid = true;
 
     for (const auto* p : m_gen.projects)
     {
+        if (p->generated)
+            continue;
+
         if (p->originalProject->type == ProjectType::LocalLibrary || p->originalProject->type == ProjectType::LocalApplication)
         {
             const fs::path projectPath = p->generatedPath / "CMakeLists.txt";
 
             auto* file = m_gen.createFile(projectPath);
             valid &= generateProjectFile(p, file->content);
+            m_gen.finishFile(file);
         }
     }
 
     return valid;
 }
 
-void SolutionGeneratorCMAKE::extractSourceRoots(const ProjectGenerator::GeneratedProject* project, std::vector<fs::path>& outPaths) const
+void ExtractSourceRoots(const Configuration& config, const ProjectGenerator& gen, const ProjectGenerator::GeneratedProject* project, std::vector<fs::path>& outPaths)
 {
-    for (const auto& sourceRoot : m_gen.sourceRoots)
+    for (const auto& sourceRoot : gen.sourceRoots)
         outPaths.push_back(sourceRoot);
 
     outPaths.push_back(project->originalProject->rootPath / "src");
     outPaths.push_back(project->originalProject->rootPath / "include");
 
-    outPaths.push_back(m_config.solutionPath / "generated/_shared");
+    outPaths.push_back(config.solutionPath / "generated/_shared");
     outPaths.push_back(project->generatedPath);
 }
 
@@ -133,7 +154,7 @@ bool SolutionGeneratorCMAKE::shouldStaticLinkProject(const ProjectGenerator::Gen
         return m_buildWithLibs;
 }
 
-bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::GeneratedProject* p, std::stringstream& f) const
+bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::GeneratedProject* p, StringBuilder& f) const
 {
     const auto windowsPlatform = (m_config.platform == PlatformType::Windows || m_config.platform == PlatformType::UWP);
 
@@ -221,13 +242,50 @@ bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::Generat
             writeln(f, "set( CMAKE_CXX_FLAGS \"${CMAKE_CXX_FLAGS} -O3 -fno-stack-protector\")");
     }
 
+    // profile guided optimization, profiles of all projects are kept in one folder
+    if (m_config.pgo != ProfileGuidedStage::None)
+    {
+        const auto profilePath = MakeGenericPath(m_config.profilePath.u8string());
+
+        if (windowsPlatform)
+        {
+            const auto profileDatabase = profilePath + "/" + p->mergedName + ".pgd";
+            const auto* profileOption = (m_config.pgo == ProfileGuidedStage::Instrument) ? "GENPROFILE" : "USEPROFILE";
+
+            writeln(f, "set(CMAKE_CXX_FLAGS \"${CMAKE_CXX_FLAGS} /GL\")");
+            writelnf(f, "set(CMAKE_EXE_LINKER_FLAGS \"${CMAKE_EXE_LINKER_FLAGS} /LTCG /%s:PGD=%s\")", profileOption, profileDatabase.c_str());
+            writelnf(f, "set(CMAKE_SHARED_LINKER_FLAGS \"${CMAKE_SHARED_LINKER_FLAGS} /LTCG /%s:PGD=%s\")", profileOption, profileDatabase.c_str());
+            writeln(f, "set(CMAKE_STATIC_LINKER_FLAGS \"${CMAKE_STATIC_LINKER_FLAGS} /LTCG\")");
+        }
+        else
+        {
+            if (m_config.pgo == ProfileGuidedStage::Instrument)
+            {
+                writelnf(f, "set(PGO_FLAGS \"-fprofile-generate=%s -fprofile-update=atomic\")", profilePath.c_str());
+            }
+            else
+            {
+                // not every source runs during the training, missing profiles are expected
+                writeln(f, "if(CMAKE_CXX_COMPILER_ID MATCHES \"Clang\")");
+                writelnf(f, "  set(PGO_FLAGS \"-fprofile-use=%s -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date\")", profilePath.c_str());
+                writeln(f, "else()");
+                writelnf(f, "  set(PGO_FLAGS \"-fprofile-use=%s -fprofile-correction -Wno-missing-profile\")", profilePath.c_str());
+                writeln(f, "endif()");
+            }
+
+            writeln(f, "set(CMAKE_CXX_FLAGS \"${CMAKE_CXX_FLAGS} ${PGO_FLAGS}\")");
+            writeln(f, "set(CMAKE_EXE_LINKER_FLAGS \"${CMAKE_EXE_LINKER_FLAGS} ${PGO_FLAGS}\")");
+            writeln(f, "set(CMAKE_SHARED_LINKER_FLAGS \"${CMAKE_SHARED_LINKER_FLAGS} ${PGO_FLAGS}\")");
+        }
+    }
+
     /*if (solutionSetup.solutionType == SolutionType.FINAL)
         writelnf(f, "add_definitions(-DBUILD_FINAL)");
     else
         writelnf(f, "add_definitions(-DBUILD_DEV)");*/
 
     std::vector<fs::path> paths;
-    extractSourceRoots(p, paths);
+    ExtractSourceRoots(m_config, m_gen, p, paths);
 
     writeln(f, "# Project include directories");
     for (const auto& path : paths)
@@ -259,7 +317,8 @@ bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::Generat
     {
         if (pf->useInCurrentBuild)
         {
-            if (fs::is_regular_file(pf->absolutePath))
+            // unity files are saved together with this file, before CMake gets to see them
+            if (pf->unityFile || fs::is_regular_file(pf->absolutePath))
             {
                 if (pf->type == ProjectFileType::CppSource)
                     writelnf(f, "list(APPEND FILE_SOURCES %s)", EscapePath(pf->absolutePath).c_str());
@@ -270,6 +329,19 @@ bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::Generat
     }
     writeln(f, "");
 
+    bool hasBatchedFiles = false;
+    for (const auto* pf : p->files)
+        hasBatchedFiles |= pf->unityBatched;
+
+    if (hasBatchedFiles)
+    {
+        writeln(f, "# Files compiled through the unity files");
+        for (const auto* pf : p->files)
+            if (pf->unityBatched)
+                writelnf(f, "set_source_files_properties(%s PROPERTIES HEADER_FILE_ONLY ON)", EscapePath(pf->absolutePath).c_str());
+        writeln(f, "");
+    }
+
     /*// get all source files
     if (requiresRTTI())
     {
@@ -325,6 +397,27 @@ bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::Generat
     {
         writeln(f, "# Hardcoded system libraries");
         writelnf(f, "target_link_libraries(%s dl rt)", p->mergedName.c_str());
+
+        if (p->originalProject->flagUsePCH)
+        {
+            writeln(f, "");
+            writeln(f, "# Precompiled header setup");
+            writelnf(f, "target_precompile_headers(%s PRIVATE %s)", p->mergedName.c_str(), EscapePath(p->generatedPath / "build.h").c_str());
+
+            // same files as in the Visual Studio build are compiled without the header, C files can't use it at all
+            for (const auto* pf : p->files)
+            {
+                if (pf->type == ProjectFileType::CppSource && pf->useInCurrentBuild && !pf->unityBatched)
+                {
+                    const bool generatedFile = !pf->originalFile && !pf->unityFile && pf->name != "build.cpp" && pf->name != "build.cxx";
+                    const bool optedOut = pf->originalFile && !pf->originalFile->flagUsePch;
+                    const bool mainFile = (pf->name == "main.cpp" || pf->name == "main.cxx");
+
+                    if (generatedFile || optedOut || mainFile || pf->absolutePath.extension() == ".c")
+                        writelnf(f, "set_source_files_properties(%s PROPERTIES SKIP_PRECOMPILE_HEADERS ON)", EscapePath(pf->absolutePath).c_str());
+                }
+            }
+        }
     }
     else if (m_config.platform == PlatformType::Windows || m_config.platform == PlatformType::UWP)
     {
@@ -336,7 +429,7 @@ bool SolutionGeneratorCMAKE::generateProjectFile(const ProjectGenerator::Generat
             {
                 if (pf->name == "build.cpp" || pf->name == "build.cxx")
                     writelnf(f, "set_source_files_properties(%s PROPERTIES COMPILE_FLAGS \"/Ycbuild.h\")", EscapePath(pf->absolutePath).c_str());
-                else if (pf->originalFile && pf->originalFile->flagUsePch)
+                else if ((pf->originalFile && pf->originalFile->flagUsePch) || pf->unityFile)
                     writelnf(f, "set_source_files_properties(%s PROPERTIES COMPILE_FLAGS \"/Yubuild.h\")", EscapePath(pf->absolutePath).c_str());
             }
         }
@@ -6,6 +6,11 @@
 
 //--
 
+// include directories of the project itself, shared with the compilation database so both builds see the same roots
+extern void ExtractSourceRoots(const Configuration& config, const ProjectGenerator& gen, const ProjectGenerator::GeneratedProject* project, std::vector<fs::path>& outPaths);
+
+//--
+
 struct SolutionGeneratorCMAKE
 {
     SolutionGeneratorCMAKE(const Configuration& config, ProjectGenerator& gen);
@@ -20,12 +25,10 @@ private:
     fs::path m_cmakeScriptsPath;
     bool m_buildWithLibs = false;
 
-    bool generateProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& outContent) const;
-
-    void extractSourceRoots(const ProjectGenerator::GeneratedProject* project, std::vector<fs::path>& outPaths) const;
+    bool generateProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
 
-    void printSolutionDeclarations(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g);    
-    void printSolutionParentLinks(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g);
+    void printSolutionDeclarations(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g);    
+    void printSolutionParentLinks(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g);
 
     bool shouldStaticLinkProject(const ProjectGenerator::GeneratedProject* project) const;
 };
@@ -0,0 +1,365 @@
+#include "common.h"
+#include "project.h"
+#include "projectGenerator.h"
+#include "solutionGeneratorNinja.h"
+#include "compilationDatabase.h"
+#include "profiler.h"
+
+SolutionGeneratorNinja::SolutionGeneratorNinja(const Configuration& config, ProjectGenerator& gen)
+    : m_config(config)
+    , m_gen(gen)
+{
+    m_libraryPath = config.solutionPath / "lib";
+    m_objectPath = config.solutionPath / "obj";
+}
+
+static bool IsBuiltProject(const ProjectGenerator::GeneratedProject* project)
+{
+    return project->originalProject->type == ProjectType::LocalLibrary || project->originalProject->type == ProjectType::LocalApplication;
+}
+
+static std::string EscapeNinjaText(std::string_view txt, bool buildLine)
+{
+    std::string ret;
+    ret.reserve(txt.length() + 8);
+
+    for (const auto ch : txt)
+    {
+        if (ch == '$' || (buildLine && (ch == ' ' || ch == ':')))
+            ret += '$';
+        ret += ch;
+    }
+
+    return ret;
+}
+
+// path used in the "build" statements, spaces and colons have to be escaped
+static std::string EscapePath(fs::path path)
+{
+    path = fs::absolute(path).make_preferred();
+
+    return EscapeNinjaText(MakeGenericPath(path.u8string()), true);
+}
+
+// path used inside of the command line, passed to the shell as is
+static std::string QuotePath(fs::path path)
+{
+    path = fs::absolute(path).make_preferred();
+
+    return "\"" + EscapeNinjaText(MakeGenericPath(path.u8string()), false) + "\"";
+}
+
+std::string SolutionGeneratorNinja::regenerateCommand() const
+{
+    std::string ret = QuotePath(m_config.builderExecutablePath);
+    ret += " -tool=make";
+    ret += " -engineDir=" + QuotePath(m_config.engineRootPath);
+    ret += " -outDir=" + QuotePath(m_config.solutionPath);
+
+    // custom deploy directory also changes the shared deploy path so pass it only if it was given
+    const auto defaultDeployPath = (m_config.engineRootPath / (".bin/" + m_config.mergedName())).make_preferred();
+    if (m_config.deployPath != defaultDeployPath)
+        ret += " -deployDir=" + QuotePath(m_config.deployPath);
+
+    ret += " -generator=";
+    ret += NameEnumOption(m_config.generator);
+    ret += " -platform=";
+    ret += NameEnumOption(m_config.platform);
+    ret += " -build=";
+    ret += NameEnumOption(m_config.build);
+    ret += " -libs=";
+    ret += NameEnumOption(m_config.libs);
+    ret += " -config=";
+    ret += NameEnumOption(m_config.configuration);
+
+    if (m_config.unity)
+        ret += " -unity";
+    if (m_config.autoPch)
+        ret += " -autoPch";
+    return ret;
+}
+
+bool SolutionGeneratorNinja::generateSolution()
+{
+    ProfileScope profile("generateSolution");
+
+    if (m_config.platform != PlatformType::Linux)
+    {
+        std::cout << "Ninja generator is only supported for the Linux platform, use the Visual Studio generator for " << NameEnumOption(m_config.platform) << "\n";
+        return false;
+    }
+
+    const auto solutionFilePath = m_config.solutionPath / "build.ninja";
+
+    auto* file = m_gen.createFile(solutionFilePath);
+    auto& f = file->content;
+
+    writeln(f, "# Inferno Engine v4");
+    writeln(f, "# Written by Tomasz Jonarski (Rex Dex)");
+    writeln(f, "# AutoGenerated file. Please DO NOT MODIFY.");
+    writeln(f, "# Build system source code licensed under MIT license");
+    writeln(f, "");
+
+    writeln(f, "ninja_required_version = 1.5");
+    writelnf(f, "builddir = %s", EscapePath(m_config.solutionPath).c_str());
+    writeln(f, "");
+
+    writelnf(f, "cc = %s", EnvironmentTool("CC", "cc"));
+    writelnf(f, "cxx = %s", EnvironmentTool("CXX", "c++"));
+    writelnf(f, "ar = %s", EnvironmentTool("AR", "ar"));
+    writeln(f, "");
+
+    // headers are tracked via the depfiles written by the compiler, ninja keeps them in its own database
+    writeln(f, "rule cc");
+    writeln(f, "  command = $cc -MMD -MF $out.d $defines $includes $pflags -c $in -o $out");
+    writeln(f, "  depfile = $out.d");
+    writeln(f, "  deps = gcc");
+    writeln(f, "  description = CC $out");
+    writeln(f, "");
+
+    writeln(f, "rule cxx");
+    writeln(f, "  command = $cxx -MMD -MF $out.d -std=c++17 $defines $includes $pflags -c $in -o $out");
+    writeln(f, "  depfile = $out.d");
+    writeln(f, "  deps = gcc");
+    writeln(f, "  description = CXX $out");
+    writeln(f, "");
+
+    writeln(f, "rule ar");
+    writeln(f, "  command = rm -f $out && $ar crs $out $in");
+    writeln(f, "  description = AR $out");
+    writeln(f, "");
+
+    writeln(f, "rule link");
+    writeln(f, "  command = $cxx -o $out $in $libs $ldflags");
+    writeln(f, "  description = LINK $out");
+    writeln(f, "");
+
+    writeln(f, "rule solink");
+    writeln(f, "  command = $cxx -shared -o $out $in $libs $ldflags");
+    writeln(f, "  description = SOLINK $out");
+    writeln(f, "");
+
+    // the reflection tool uses all of the cores by itself, running many of them at once only thrashes the machine
+    writeln(f, "pool reflection");
+    writeln(f, "  depth = 1");
+    writeln(f, "");
+
+    writeln(f, "rule reflection");
+    writelnf(f, "  command = %s -tool=reflection -list=$in", QuotePath(m_config.builderExecutablePath).c_str());
+    writeln(f, "  pool = reflection");
+    writeln(f, "  restat = 1");
+    writeln(f, "  description = REFLECTION $out");
+    writeln(f, "");
+
+    // files that are not changed are not written so restat is needed to avoid regenerating over and over
+    writeln(f, "rule regenerate");
+    writelnf(f, "  command = %s", regenerateCommand().c_str());
+    writeln(f, "  generator = 1");
+    writeln(f, "  restat = 1");
+    writeln(f, "  description = Regenerating build files");
+    writeln(f, "");
+
+    f << "build " << EscapePath(solutionFilePath) << ": regenerate | " << EscapePath(m_config.builderExecutablePath);
+    for (const auto* p : m_gen.projects)
+    {
+        if (p->originalProject)
+        {
+            const auto scriptPath = p->originalProject->rootPath / "build.lua";
+            if (fs::is_regular_file(scriptPath))
+                f << " $\n    " << EscapePath(scriptPath);
+        }
+    }
+    f << "\n";
+    writeln(f, "");
+
+    for (const auto* p : m_gen.projects)
+        if (IsBuiltProject(p))
+            writelnf(f, "subninja %s", EscapePath(p->generatedPath / "build.ninja").c_str());
+
+    m_gen.finishFile(file);
+    return true;
+}
+
+bool SolutionGeneratorNinja::generateProjects()
+{
+    ProfileScope profile("generateProjects");
+
+    bool valid = true;
+
+    for (const auto* p : m_gen.projects)
+    {
+        if (IsBuiltProject(p) && !p->generated)
+        {
+            if (p->hasReflection)
+            {
+                auto* file = m_gen.createFile(p->generatedPath / "reflection_list.txt");
+                valid &= generateProjectReflectionList(p, file->content);
+                m_gen.finishFile(file);
+            }
+
+            auto* file = m_gen.createFile(p->generatedPath / "build.ninja");
+            valid &= generateProjectFile(p, file->content);
+            m_gen.finishFile(file);
+        }
+    }
+
+    return valid;
+}
+
+fs::path SolutionGeneratorNinja::projectOutputFile(const ProjectGenerator::GeneratedProject* project) const
+{
+    if (project->originalProject->type == ProjectType::LocalApplication)
+        return m_config.deployPath / project->mergedName;
+    else if (project->willBeDLL)
+        return m_libraryPath / ("lib" + project->mergedName + ".so");
+    else
+        return m_libraryPath / ("lib" + project->mergedName + ".a");
+}
+
+fs::path SolutionGeneratorNinja::projectObjectFile(const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file) const
+{
+    // generated files have no place in the project's source tree, keep them apart so the names can't clash
+    if (file->originalFile)
+        return m_objectPath / project->mergedName / (file->originalFile->projectRelativePath + ".o");
+    else
+        return m_objectPath / project->mergedName / "_generated" / (file->name + ".o");
+}
+
+bool SolutionGeneratorNinja::generateProjectReflectionList(const ProjectGenerator::GeneratedProject* p, StringBuilder& f) const
+{
+    // same format as the solution wide list used by the Visual Studio build, just with the single project and without its own output
+    writeln(f, NameEnumOption(m_config.platform));
+    writeln(f, NameEnumOption(m_config.build));
+    writeln(f, "PROJECT");
+    writeln(f, p->mergedName);
+    writeln(f, p->localReflectionFile.u8string());
+
+    for (const auto* pf : p->files)
+        if (pf->type == ProjectFileType::CppSource && !pf->unityFile && pf->absolutePath != p->localReflectionFile)
+            writeln(f, pf->absolutePath.u8string());
+
+    return true;
+}
+
+bool SolutionGeneratorNinja::generateProjectFile(const ProjectGenerator::GeneratedProject* p, StringBuilder& f) const
+{
+    writeln(f, "# Inferno Engine v4");
+    writeln(f, "# Written by Tomasz Jonarski (Rex Dex)");
+    writeln(f, "# Build system source code licensed under MIT license");
+    writeln(f, "# AutoGenerated file. Please DO NOT MODIFY.");
+    writeln(f, "");
+
+    const bool isApplication = (p->originalProject->type == ProjectType::LocalApplication);
+
+    // arguments of the CMake build extended with the settings from the build scripts
+    ProjectCompileArguments args;
+    args.extract(m_config, m_gen, p);
+    args.extractProjectSettings(p);
+
+    // static libraries may end up inside of the shared ones
+    if (!isApplication && !p->willBeDLL)
+        args.flags.push_back("-fPIC");
+
+    f << "defines =";
+    for (const auto& define : args.defines)
+        f << " -D" << EscapeNinjaText(define, false);
+    f << "\n";
+
+    f << "includes =";
+    for (const auto& path : args.includePaths)
+        f << " $\n    -I" << QuotePath(path);
+    f << "\n";
+
+    f << "pflags =";
+    for (const auto& flag : args.flags)
+        f << " " << flag;
+    f << "\n";
+    writeln(f, "");
+
+    // reflection is generated from the project sources before anything is compiled
+    if (p->hasReflection)
+    {
+        f << "build " << EscapePath(p->localReflectionFile) << ": reflection " << EscapePath(p->generatedPath / "reflection_list.txt") << " |";
+        for (const auto* pf : p->files)
+            if (pf->type == ProjectFileType::CppSource && !pf->unityFile && pf->absolutePath != p->localReflectionFile)
+                f << " $\n    " << EscapePath(pf->absolutePath);
+        f << "\n";
+        writeln(f, "");
+    }
+
+    // compilation
+    std::vector<fs::path> objectFiles;
+    for (const auto* pf : p->files)
+    {
+        if (pf->useInCurrentBuild && pf->type == ProjectFileType::CppSource && !pf->unityBatched)
+        {
+            const auto objectPath = projectObjectFile(p, pf);
+            const auto* rule = (pf->absolutePath.extension() == ".c") ? "cc" : "cxx";
+            writelnf(f, "build %s: %s %s", EscapePath(objectPath).c_str(), rule, EscapePath(pf->absolutePath).c_str());
+            objectFiles.push_back(objectPath);
+        }
+    }
+    writeln(f, "");
+
+    // linking, dependencies follow the order used by the CMake build
+    const auto outputPath = projectOutputFile(p);
+    if (isApplication || p->willBeDLL)
+    {
+        auto deps = isApplication ? p->allDependencies : p->directDependencies;
+        std::reverse(deps.begin(), deps.end());
+
+        std::vector<fs::path> linkedFiles;
+        for (const auto* dep : deps)
+            if (dep->originalProject->type == ProjectType::LocalLibrary && !dep->originalProject->flagPureDynamicLibrary)
+                linkedFiles.push_back(projectOutputFile(dep));
+
+        // external libraries of the statically linked dependencies have to be linked here as well
+        OrderedSet<std::string> externalFiles;
+        for (const auto* lib : p->originalProject->resolvedDependencies)
+            if (lib->type == ProjectType::ExternalLibrary)
+                for (const auto& path : lib->libraryLinkFile)
+                    externalFiles.insert(path.u8string());
+
+        for (const auto* dep : deps)
+            if (!dep->willBeDLL)
+                for (const auto* lib : dep->originalProject->resolvedDependencies)
+                    if (lib->type == ProjectType::ExternalLibrary)
+                        for (const auto& path : lib->libraryLinkFile)
+                            externalFiles.insert(path.u8string());
+
+        f << "build " << EscapePath(outputPath) << ": " << (isApplication ? "link" : "solink");
+        for (const auto& path : objectFiles)
+            f << " $\n    " << EscapePath(path);
+        if (!linkedFiles.empty())
+        {
+            f << " |";
+            for (const auto& path : linkedFiles)
+                f << " $\n    " << EscapePath(path);
+        }
+        f << "\n";
+
+        f << "  libs = -Wl,--start-group";
+        for (const auto& path : linkedFiles)
+            f << " " << QuotePath(path);
+        for (const auto& path : externalFiles)
+            f << " " << QuotePath(path);
+        f << " -Wl,--end-group -ldl -lrt\n";
+
+        f << "  ldflags = -pthread -Wl,-rpath," << QuotePath(m_libraryPath) << "\n";
+    }
+    else
+    {
+        f << "build " << EscapePath(outputPath) << ": ar";
+        for (const auto& path : objectFiles)
+            f << " $\n    " << EscapePath(path);
+        f << "\n";
+    }
+    writeln(f, "");
+
+    writelnf(f, "build %s: phony %s", p->mergedName.c_str(), EscapePath(outputPath).c_str());
+    writeln(f, "");
+
+    return true;
+}
+
+//--
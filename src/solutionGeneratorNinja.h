@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils.h"
+#include "project.h"
+#include "projectGenerator.h"
+
+//--
+
+// Writes build.ninja files directly, without going through the CMake configure step
+// The root file holds the rules and the self regeneration, each project gets its own file included via subninja
+struct SolutionGeneratorNinja
+{
+    SolutionGeneratorNinja(const Configuration& config, ProjectGenerator& gen);
+
+    bool generateSolution();
+    bool generateProjects();
+
+private:
+    const Configuration& m_config;
+    ProjectGenerator& m_gen;
+
+    fs::path m_libraryPath; // static and shared libraries
+    fs::path m_objectPath; // object files, one folder per project
+
+    bool generateProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
+    bool generateProjectReflectionList(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
+
+    fs::path projectOutputFile(const ProjectGenerator::GeneratedProject* project) const;
+    fs::path projectObjectFile(const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file) const;
+
+    std::string regenerateCommand() const;
+};
+
+//--
@@ -2,6 +2,7 @@
 #include "project.h"
 #include "projectGenerator.h"
 #include "solutionGeneratorVS.h"
+#include "profiler.h"
 
 SolutionGeneratorVS::SolutionGeneratorVS(const Configuration& config, ProjectGenerator& gen)
     : m_config(config)
@@ -22,7 +23,7 @@ SolutionGeneratorVS::SolutionGeneratorVS(const Configuration& config, ProjectGen
     }
 }
 
-void SolutionGeneratorVS::printSolutionDeclarations(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g)
+void SolutionGeneratorVS::printSolutionDeclarations(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g)
 {
     writelnf(f, "Project(\"{2150E333-8FDC-42A3-9474-1A3956D46DE8}\") = \"%s\", \"%s\", \"%s\"", g->name.c_str(), g->name.c_str(), g->assignedVSGuid.c_str());
     writeln(f, "EndProject");
@@ -41,7 +42,7 @@ void SolutionGeneratorVS::printSolutionDeclarations(std::stringstream& f, const
     }
 }
 
-void SolutionGeneratorVS::printSolutionScriptDeclarations(std::stringstream& f)
+void SolutionGeneratorVS::printSolutionScriptDeclarations(StringBuilder& f)
 {
     if (!m_gen.scriptProjects.empty())
     {
@@ -58,7 +59,7 @@ void SolutionGeneratorVS::printSolutionScriptDeclarations(std::stringstream& f)
     }
 }
 
-void SolutionGeneratorVS::printSolutionParentScriptLinks(std::stringstream& f)
+void SolutionGeneratorVS::printSolutionParentScriptLinks(StringBuilder& f)
 {
     if (!m_gen.scriptProjects.empty())
     {
@@ -69,7 +70,7 @@ void SolutionGeneratorVS::printSolutionParentScriptLinks(std::stringstream& f)
     }
 }
 
-void SolutionGeneratorVS::printSolutionParentLinks(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g)
+void SolutionGeneratorVS::printSolutionParentLinks(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g)
 {
     for (const auto* child : g->children)
     {
@@ -113,6 +114,8 @@ static const char* NameVisualStudioPlatform(PlatformType config)
 
 bool SolutionGeneratorVS::generateSolution()
 {
+    ProfileScope profile("generateSolution");
+
     const auto solutionFileName = std::string("inferno.") + m_config.mergedName() + ".sln";
 
     auto* file = m_gen.createFile(m_config.solutionPath / solutionFileName);
@@ -179,15 +182,22 @@ bool SolutionGeneratorVS::generateSolution()
     }
 
     writeln(f, "EndGlobal");
+
+    m_gen.finishFile(file);
     return true;
 }
 
 bool SolutionGeneratorVS::generateProjects()
 {
+    ProfileScope profile("generateProjects");
+
     bool valid = true;
 
     for (const auto* p : m_gen.projects)
     {
+        if (p->generated)
+            continue;
+
         if (p->originalProject->type == ProjectType::LocalLibrary || p->originalProject->type == ProjectType::LocalApplication)
         {
             {
@@ -196,6 +206,7 @@ bool SolutionGeneratorVS::generateProjects()
 
                 auto* file = m_gen.createFile(projectFilePath);
                 valid &= generateSourcesProjectFile(p, file->content);
+                m_gen.finishFile(file);
             }
 
             {
@@ -204,6 +215,7 @@ bool SolutionGeneratorVS::generateProjects()
 
                 auto* file = m_gen.createFile(projectFilePath);
                 valid &= generateSourcesProjectFilters(p, file->content);
+                m_gen.finishFile(file);
             }
         }
         else if (p->originalProject->type == ProjectType::RttiGenerator)
@@ -214,6 +226,7 @@ bool SolutionGeneratorVS::generateProjects()
 
                 auto* file = m_gen.createFile(projectFilePath);
                 valid &= generateRTTIGenProjectFile(p, file->content);
+                m_gen.finishFile(file);
             }
         }
         else if (p->originalProject->type == ProjectType::EmbeddedMedia)
@@ -224,6 +237,7 @@ bool SolutionGeneratorVS::generateProjects()
 
                 auto* file = m_gen.createFile(projectFilePath);
                 valid &= generateEmbeddedMediaProjectFile(p, file->content);
+                m_gen.finishFile(file);
             }
         }
     }
@@ -252,15 +266,7 @@ void SolutionGeneratorVS::extractSourceRoots(const ProjectGenerator::GeneratedPr
     }
 }
 
-extern void CollectDefineString(std::vector<std::pair<std::string, std::string>>& ar, std::string_view name, std::string_view value);
-
-void CollectDefineStrings(std::vector<std::pair<std::string, std::string>>& ar, const std::vector<std::pair<std::string, std::string>>& defs)
-{
-    for (const auto& def : defs)
-        CollectDefineString(ar, def.first, def.second);
-}
-
-bool SolutionGeneratorVS::generateSourcesProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& f) const
+bool SolutionGeneratorVS::generateSourcesProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& f) const
 {
     writeln(f, "<?xml version=\"1.0\" encoding=\"utf-8\"?>");
     writeln(f, "<!-- Auto generated file, please do not edit -->");
@@ -327,6 +333,14 @@ bool SolutionGeneratorVS::generateSourcesProjectFile(const ProjectGenerator::Gen
     writelnf(f, " 	<ProjectGeneratedPath>%s\\</ProjectGeneratedPath>", project->generatedPath.u8string().c_str());
     writelnf(f, " 	<ProjectPublishPath>%s\\</ProjectPublishPath>", m_config.deployPath.u8string().c_str());
     writelnf(f, " 	<ProjectSourceRoot>%s\\</ProjectSourceRoot>", project->originalProject->rootPath.u8string().c_str());
+
+    // profile guided optimization, consumed by SharedItemGroups.props
+    if (m_config.pgo != ProfileGuidedStage::None)
+    {
+        const auto profileDatabase = m_config.profilePath / (project->mergedName + ".pgd");
+        writelnf(f, " 	<ProjectProfileGuidedStage>%s</ProjectProfileGuidedStage>", (m_config.pgo == ProfileGuidedStage::Instrument) ? "Instrument" : "Optimize");
+        writelnf(f, " 	<ProjectProfileDatabase>%s</ProjectProfileDatabase>", profileDatabase.u8string().c_str());
+    }
     //writelnf(f, " 	<ProjectPathName>%s</ProjectPathName>", relativeSourceDir.u8string().c_str());
 
     if (project->originalProject->flagNoWarnings)
@@ -500,7 +514,7 @@ bool SolutionGeneratorVS::generateSourcesProjectFile(const ProjectGenerator::Gen
     return true;
 }
 
-bool SolutionGeneratorVS::generateSourcesProjectFileEntry(const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file, std::stringstream& f) const
+bool SolutionGeneratorVS::generateSourcesProjectFileEntry(const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file, StringBuilder& f) const
 {
     switch (file->type)
     {
@@ -521,7 +535,7 @@ bool SolutionGeneratorVS::generateSourcesProjectFileEntry(const ProjectGenerator
             {
                 if (file->name == "build.cpp" || file->name == "build.cxx")
                     writeln(f, "      <PrecompiledHeader>Create</PrecompiledHeader>");
-                else if (!file->originalFile || !file->originalFile->flagUsePch || file->name == "main.cpp" || file->name == "main.cxx")
+                else if ((!file->originalFile && !file->unityFile) || (file->originalFile && !file->originalFile->flagUsePch) || file->name == "main.cpp" || file->name == "main.cxx")
                     writeln(f, "      <PrecompiledHeader>NotUsing</PrecompiledHeader>");
             }
             else
@@ -529,7 +543,8 @@ bool SolutionGeneratorVS::generateSourcesProjectFileEntry(const ProjectGenerator
                 writeln(f, "      <PrecompiledHeader>NotUsing</PrecompiledHeader>");
             }
 
-            if (!file->useInCurrentBuild)
+            // sources batched into unity files stay in the project for editing but are not compiled on their own
+            if (!file->useInCurrentBuild || file->unityBatched)
                 writeln(f, "      <ExcludedFromBuild>true</ExcludedFromBuild>");
 
             if (m_config.platform == PlatformType::UWP)
@@ -634,7 +649,7 @@ static void AddFilterSectionRecursive(std::string_view path, std::vector<std::st
     
 }
 
-bool SolutionGeneratorVS::generateSourcesProjectFilters(const ProjectGenerator::GeneratedProject* project, std::stringstream& f) const
+bool SolutionGeneratorVS::generateSourcesProjectFilters(const ProjectGenerator::GeneratedProject* project, StringBuilder& f) const
 {
     writeln(f, "<?xml version=\"1.0\" encoding=\"utf-8\"?>");
     writeln(f, "<!-- Auto generated file, please do not edit -->");
@@ -703,7 +718,7 @@ bool SolutionGeneratorVS::generateSourcesProjectFilters(const ProjectGenerator::
     return true;
 }
 
-bool SolutionGeneratorVS::generateEmbeddedMediaProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& f) const
+bool SolutionGeneratorVS::generateEmbeddedMediaProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& f) const
 {
     writeln(f, "<?xml version=\"1.0\" encoding=\"utf-8\"?>");
     writeln(f, "<!-- Auto generated file, please do not edit -->");
@@ -777,7 +792,7 @@ bool SolutionGeneratorVS::generateEmbeddedMediaProjectFile(const ProjectGenerato
     return true;
 }
 
-bool SolutionGeneratorVS::generateRTTIGenProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& f) const
+bool SolutionGeneratorVS::generateRTTIGenProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& f) const
 {
     writeln(f, "<?xml version=\"1.0\" encoding=\"utf-8\"?>");
     writeln(f, "<!-- Auto generated file, please do not edit -->");
@@ -23,20 +23,20 @@ private:
     const char* m_projectVersion = nullptr;
     const char* m_toolsetVersion = nullptr;
 
-    bool generateSourcesProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& outContent) const;
-    bool generateSourcesProjectFilters(const ProjectGenerator::GeneratedProject* project, std::stringstream& outContent) const;
-    bool generateSourcesProjectFileEntry(const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file, std::stringstream& f) const;
+    bool generateSourcesProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
+    bool generateSourcesProjectFilters(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
+    bool generateSourcesProjectFileEntry(const ProjectGenerator::GeneratedProject* project, const ProjectGenerator::GeneratedProjectFile* file, StringBuilder& f) const;
 
-    bool generateRTTIGenProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& outContent) const;
-    bool generateEmbeddedMediaProjectFile(const ProjectGenerator::GeneratedProject* project, std::stringstream& outContent) const;
+    bool generateRTTIGenProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
+    bool generateEmbeddedMediaProjectFile(const ProjectGenerator::GeneratedProject* project, StringBuilder& outContent) const;
 
     void extractSourceRoots(const ProjectGenerator::GeneratedProject* project, std::vector<fs::path>& outPaths) const;
 
-    void printSolutionDeclarations(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g);
-    void printSolutionParentLinks(std::stringstream& f, const ProjectGenerator::GeneratedGroup* g);
+    void printSolutionDeclarations(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g);
+    void printSolutionParentLinks(StringBuilder& f, const ProjectGenerator::GeneratedGroup* g);
 
-    void printSolutionScriptDeclarations(std::stringstream& f);
-    void printSolutionParentScriptLinks(std::stringstream& f);
+    void printSolutionScriptDeclarations(StringBuilder& f);
+    void printSolutionParentScriptLinks(StringBuilder& f);
 };
 
 //--
\ No newline at end of file
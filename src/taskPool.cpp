@@ -0,0 +1,139 @@
+#include "common.h"
+#include "taskPool.h"
+
+//--
+
+static thread_local TaskPool* GCurrentPool = nullptr;
+static thread_local uint32_t GCurrentWorkerIndex = 0;
+
+TaskPool::TaskPool(uint32_t numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+
+    for (uint32_t i = 0; i < numThreads; ++i)
+        m_workers.push_back(new Worker);
+
+    for (uint32_t i = 0; i < numThreads; ++i)
+        m_workers[i]->thread = std::thread([this, i]() { workerThread(i); });
+}
+
+TaskPool::~TaskPool()
+{
+    wait();
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_exiting = true;
+    }
+
+    m_wakeCondition.notify_all();
+
+    for (auto* worker : m_workers)
+    {
+        worker->thread.join();
+        delete worker;
+    }
+}
+
+void TaskPool::submit(TTask task)
+{
+    // tasks spawned by our own workers are kept local, others are distributed
+    uint32_t queueIndex = 0;
+    if (GCurrentPool == this)
+        queueIndex = GCurrentWorkerIndex;
+    else
+        queueIndex = m_nextQueue++ % m_workers.size();
+
+    m_numPendingTasks += 1;
+
+    {
+        auto* worker = m_workers[queueIndex];
+        std::unique_lock<std::mutex> lock(worker->lock);
+        worker->queue.push_back(std::move(task));
+        m_numQueuedTasks += 1;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+    }
+
+    m_wakeCondition.notify_one();
+}
+
+void TaskPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_doneCondition.wait(lock, [this]() { return m_numPendingTasks == 0; });
+}
+
+void TaskPool::parallelFor(uint32_t count, const std::function<void(uint32_t index, uint32_t workerIndex)>& func)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        submit([&func, i](uint32_t workerIndex) { func(i, workerIndex); });
+
+    wait();
+}
+
+bool TaskPool::popTask(uint32_t workerIndex, TTask& outTask)
+{
+    // newest task from our own queue
+    {
+        auto* worker = m_workers[workerIndex];
+        std::unique_lock<std::mutex> lock(worker->lock);
+        if (!worker->queue.empty())
+        {
+            outTask = std::move(worker->queue.back());
+            worker->queue.pop_back();
+            m_numQueuedTasks -= 1;
+            return true;
+        }
+    }
+
+    // oldest task from other queues
+    for (uint32_t i = 1; i < m_workers.size(); ++i)
+    {
+        auto* worker = m_workers[(workerIndex + i) % m_workers.size()];
+        std::unique_lock<std::mutex> lock(worker->lock);
+        if (!worker->queue.empty())
+        {
+            outTask = std::move(worker->queue.front());
+            worker->queue.pop_front();
+            m_numQueuedTasks -= 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskPool::workerThread(uint32_t workerIndex)
+{
+    GCurrentPool = this;
+    GCurrentWorkerIndex = workerIndex;
+
+    for (;;)
+    {
+        TTask task;
+        if (popTask(workerIndex, task))
+        {
+            task(workerIndex);
+
+            if (--m_numPendingTasks == 0)
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_doneCondition.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_wakeCondition.wait(lock, [this]() { return m_exiting || m_numQueuedTasks > 0; });
+
+        if (m_exiting && m_numQueuedTasks == 0)
+            break;
+    }
+}
+
+//--
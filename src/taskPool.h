@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common.h"
+
+//--
+
+// Simple work-stealing task pool
+// Each worker has its own queue, tasks submitted from inside of a task go to the local queue of the worker (LIFO)
+// Idle workers steal from the other end of the queues of other workers (FIFO)
+class TaskPool
+{
+public:
+    typedef std::function<void(uint32_t workerIndex)> TTask;
+
+    TaskPool(uint32_t numThreads = 0); // 0 - use all hardware threads
+    ~TaskPool();
+
+    //--
+
+    inline uint32_t numWorkers() const { return (uint32_t)m_workers.size(); }
+
+    //--
+
+    // submit task for execution, can be called from any thread, including the tasks themselves
+    void submit(TTask task);
+
+    // wait for all submitted tasks (including tasks submitted by other tasks) to finish
+    void wait();
+
+    // run function for each index in range [0, count) and wait for all of them to finish
+    void parallelFor(uint32_t count, const std::function<void(uint32_t index, uint32_t workerIndex)>& func);
+
+private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<TTask> queue;
+        std::thread thread;
+    };
+
+    std::vector<Worker*> m_workers;
+
+    std::mutex m_lock;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+
+    std::atomic<uint32_t> m_numQueuedTasks = 0; // tasks waiting in any queue
+    std::atomic<uint32_t> m_numPendingTasks = 0; // tasks not yet finished
+    std::atomic<uint32_t> m_nextQueue = 0;
+    bool m_exiting = false;
+
+    void workerThread(uint32_t workerIndex);
+
+    bool popTask(uint32_t workerIndex, TTask& outTask);
+};
+
+//--
@@ -0,0 +1,327 @@
+#include "common.h"
+#include "toolBenchmark.h"
+#include "toolMake.h"
+
+//--
+
+struct BenchmarkSettings
+{
+    uint32_t numProjects = 200;
+    uint32_t numFiles = 20; // per project, each file is a .cpp + .h pair
+    uint32_t dependencyFanOut = 4; // max direct dependencies of a project
+    uint32_t wildcardPercent = 10; // projects that depend on whole group via "group_*"
+    uint32_t mediaPercent = 10; // projects with a media folder
+    uint32_t reflectionPercent = 50; // source files with reflection macros
+    uint32_t seed = 1;
+    uint32_t numWarmRuns = 3;
+
+    std::string describe() const
+    {
+        std::stringstream f;
+        f << "projects=" << numProjects << " files=" << numFiles << " fanOut=" << dependencyFanOut;
+        f << " wildcards=" << wildcardPercent << "% media=" << mediaPercent << "% reflection=" << reflectionPercent << "% seed=" << seed;
+        return f.str();
+    }
+};
+
+static bool ParseSetting(const Commandline& cmdline, const char* name, uint32_t& outValue)
+{
+    const auto& str = cmdline.get(name);
+    if (str.empty())
+        return true;
+
+    Parser parser(str);
+    if (!parser.parseUint32(outValue))
+    {
+        std::cout << "Invalid value '" << str << "' specified for -" << name << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+static bool WriteBenchmarkFile(const fs::path& path, std::string_view content)
+{
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "Failed to write benchmark file " << path << "\n";
+        return false;
+    }
+
+    file << content;
+    return true;
+}
+
+//--
+
+static const char* BENCHMARK_GROUPS[] = { "base", "core", "engine", "plugin", "app" };
+static const uint32_t BENCHMARK_NUM_GROUPS = sizeof(BENCHMARK_GROUPS) / sizeof(BENCHMARK_GROUPS[0]);
+
+struct BenchmarkProject
+{
+    uint32_t group = 0;
+    std::string name; // "p0012"
+    std::string mergedName; // "engine_p0012"
+};
+
+static bool GenerateBenchmarkProject(const fs::path& sourcesPath, const BenchmarkSettings& settings, const std::vector<BenchmarkProject>& projects, uint32_t index, std::mt19937& random)
+{
+    const auto& project = projects[index];
+    const auto projectPath = sourcesPath / BENCHMARK_GROUPS[project.group] / project.name;
+    const auto isApp = (project.group == BENCHMARK_NUM_GROUPS - 1);
+
+    bool valid = true;
+
+    // script, dependencies only go to the projects created before so there are no cycles
+    {
+        std::stringstream f;
+        f << "-- synthetic project " << project.mergedName << "\n";
+        f << "ProjectType(\"" << (isApp ? "test" : "library") << "\")\n";
+
+        if (index > 0)
+        {
+            const auto numDeps = random() % (settings.dependencyFanOut + 1);
+            std::vector<uint32_t> deps;
+            for (uint32_t i = 0; i < numDeps; ++i)
+            {
+                const auto dep = (uint32_t)(random() % index);
+                if (projects[dep].group != BENCHMARK_NUM_GROUPS - 1)
+                    PushBackUnique(deps, dep);
+            }
+
+            for (const auto dep : deps)
+                f << "Dependency(\"" << projects[dep].mergedName << "\")\n";
+        }
+
+        // all projects of the previous groups are already created so the wildcard is safe
+        if (project.group > 0 && (random() % 100) < settings.wildcardPercent)
+            f << "Dependency(\"" << BENCHMARK_GROUPS[random() % project.group] << "_*\")\n";
+
+        if (settings.numFiles > 0 && (random() % 4) == 0)
+            f << "FileOption(\"src/file0.cpp\", \"nopch\")\n";
+
+        valid &= WriteBenchmarkFile(projectPath / "build.lua", f.str());
+    }
+
+    // public header
+    {
+        std::stringstream f;
+        f << "#pragma once\n\n";
+        f << "#include <vector>\n\n";
+        f << "namespace " << project.mergedName << " { int Public(); }\n";
+        valid &= WriteBenchmarkFile(projectPath / "include" / (project.name + ".h"), f.str());
+    }
+
+    // sources
+    for (uint32_t i = 0; i < settings.numFiles; ++i)
+    {
+        const auto fileName = std::string("file") + std::to_string(i);
+
+        {
+            std::stringstream f;
+            f << "#pragma once\n\n";
+            f << "BEGIN_INFERNO_NAMESPACE()\n\n";
+            f << "class Type" << i << " { public: int value = " << i << "; };\n\n";
+            f << "END_INFERNO_NAMESPACE()\n";
+            valid &= WriteBenchmarkFile(projectPath / "src" / (fileName + ".h"), f.str());
+        }
+
+        {
+            std::stringstream f;
+            f << "#include \"build.h\"\n";
+            f << "#include \"" << fileName << ".h\"\n\n";
+            f << "BEGIN_INFERNO_NAMESPACE()\n\n";
+
+            if ((random() % 100) < settings.reflectionPercent)
+            {
+                f << "RTTI_BEGIN_TYPE_CLASS(Type" << i << ");\n";
+                f << "    RTTI_PROPERTY(value);\n";
+                f << "RTTI_END_TYPE();\n\n";
+            }
+
+            f << "END_INFERNO_NAMESPACE()\n";
+            valid &= WriteBenchmarkFile(projectPath / "src" / (fileName + ".cpp"), f.str());
+        }
+    }
+
+    // media
+    if ((random() % 100) < settings.mediaPercent)
+    {
+        valid &= WriteBenchmarkFile(projectPath / "media" / "shaders.lua", "-- synthetic media script\n");
+        valid &= WriteBenchmarkFile(projectPath / "media" / "shaders" / "common.h", "// synthetic media file\n");
+        valid &= WriteBenchmarkFile(projectPath / "media" / "shaders" / "default.fx", "// synthetic media file\n");
+    }
+
+    return valid;
+}
+
+static bool GenerateBenchmarkTree(const fs::path& rootPath, const BenchmarkSettings& settings)
+{
+    // reuse the tree if it was generated with the same settings, writing it takes longer than the benchmark itself
+    const auto markerPath = rootPath / "benchmark.txt";
+    const auto description = settings.describe();
+
+    {
+        std::string existingDescription;
+        if (fs::is_regular_file(markerPath) && LoadFileToString(markerPath, existingDescription) && existingDescription == description)
+        {
+            std::cout << "Using existing benchmark tree at " << rootPath << "\n";
+            return true;
+        }
+    }
+
+    std::cout << "Generating benchmark tree at " << rootPath << " (" << description << ")\n";
+
+    {
+        std::error_code ec;
+        fs::remove_all(rootPath, ec);
+    }
+
+    std::mt19937 random(settings.seed);
+
+    std::vector<BenchmarkProject> projects;
+    for (uint32_t i = 0; i < settings.numProjects; ++i)
+    {
+        BenchmarkProject project;
+        project.group = (i * BENCHMARK_NUM_GROUPS) / settings.numProjects; // groups follow each other
+        project.name = std::string("p") + std::to_string(i);
+        project.mergedName = std::string(BENCHMARK_GROUPS[project.group]) + "_" + project.name;
+        projects.push_back(project);
+    }
+
+    bool valid = true;
+    for (uint32_t i = 0; i < settings.numProjects; ++i)
+        valid &= GenerateBenchmarkProject(rootPath / "src", settings, projects, i, random);
+
+    valid &= WriteBenchmarkFile(markerPath, description);
+    return valid;
+}
+
+//--
+
+static bool RunTimedMake(const char* argv0, const Commandline& makeCmdline, double& outTimeMs)
+{
+    // the make tool is quite verbose, keep the output only in case it fails
+    std::stringstream log;
+    auto* oldBuffer = std::cout.rdbuf(log.rdbuf());
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    ToolMake tool;
+    const auto ret = tool.run(argv0, makeCmdline);
+
+    outTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout.rdbuf(oldBuffer);
+
+    if (ret != 0)
+    {
+        std::cout << log.str();
+        std::cout << "Make tool failed on the benchmark tree\n";
+        return false;
+    }
+
+    return true;
+}
+
+static void AddArg(Commandline& cmdline, const char* key, std::string_view value)
+{
+    Commandline::Arg arg;
+    arg.key = key;
+    arg.value = std::string(value);
+    arg.values.push_back(arg.value);
+    cmdline.args.push_back(arg);
+}
+
+ToolBenchmark::ToolBenchmark()
+{}
+
+int ToolBenchmark::run(const char* argv0, const Commandline& cmdline)
+{
+    BenchmarkSettings settings;
+
+    bool valid = true;
+    valid &= ParseSetting(cmdline, "projects", settings.numProjects);
+    valid &= ParseSetting(cmdline, "files", settings.numFiles);
+    valid &= ParseSetting(cmdline, "fanOut", settings.dependencyFanOut);
+    valid &= ParseSetting(cmdline, "wildcards", settings.wildcardPercent);
+    valid &= ParseSetting(cmdline, "media", settings.mediaPercent);
+    valid &= ParseSetting(cmdline, "reflection", settings.reflectionPercent);
+    valid &= ParseSetting(cmdline, "seed", settings.seed);
+    valid &= ParseSetting(cmdline, "runs", settings.numWarmRuns);
+    if (!valid)
+        return -1;
+
+    if (settings.numProjects == 0)
+    {
+        std::cout << "Benchmark requires at least one project\n";
+        return -1;
+    }
+
+    fs::path rootPath = cmdline.get("benchmarkDir");
+    if (rootPath.empty())
+        rootPath = fs::current_path() / ".benchmark";
+    rootPath = fs::absolute(rootPath).make_preferred();
+
+    if (!GenerateBenchmarkTree(rootPath, settings))
+        return -1;
+
+    //--
+
+    Commandline makeCmdline;
+    AddArg(makeCmdline, "engineDir", rootPath.u8string());
+    AddArg(makeCmdline, "generator", "cmake");
+#ifdef _WIN32
+    AddArg(makeCmdline, "platform", "windows");
+#else
+    AddArg(makeCmdline, "platform", "linux");
+#endif
+
+    const auto& threads = cmdline.get("threads");
+    if (!threads.empty())
+        AddArg(makeCmdline, "threads", threads);
+
+    // cold run starts without any previous output, snapshot or script cache
+    {
+        std::error_code ec;
+        fs::remove_all(rootPath / ".temp", ec);
+        fs::remove_all(rootPath / ".bin", ec);
+    }
+
+    double coldTime = 0.0;
+    if (!RunTimedMake(argv0, makeCmdline, coldTime))
+        return -1;
+
+    std::vector<double> warmTimes;
+    for (uint32_t i = 0; i < settings.numWarmRuns; ++i)
+    {
+        double time = 0.0;
+        if (!RunTimedMake(argv0, makeCmdline, time))
+            return -1;
+
+        warmTimes.push_back(time);
+    }
+
+    //--
+
+    std::cout << "Benchmark: " << settings.describe() << "\n";
+    std::cout << "  Cold run: " << (uint32_t)coldTime << " ms\n";
+
+    if (!warmTimes.empty())
+    {
+        double total = 0.0;
+        for (const auto time : warmTimes)
+            total += time;
+
+        std::cout << "  Warm runs: " << warmTimes.size() << ", min " << (uint32_t)*std::min_element(warmTimes.begin(), warmTimes.end()) << " ms";
+        std::cout << ", avg " << (uint32_t)(total / warmTimes.size()) << " ms\n";
+    }
+
+    return 0;
+}
+
+//--
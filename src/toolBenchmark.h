@@ -0,0 +1,17 @@
+#pragma once
+
+#include "utils.h"
+#include "project.h"
+
+//--
+
+// Generates synthetic engine source tree and measures the end-to-end time of the make tool on it
+class ToolBenchmark
+{
+public:
+    ToolBenchmark();
+
+    int run(const char* argv0, const Commandline& cmdline);
+};
+
+//--
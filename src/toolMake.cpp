@@ -9,6 +9,11 @@
 #include "projectGenerator.h"
 #include "solutionGeneratorVS.h"
 #include "solutionGeneratorCMAKE.h"
+#include "solutionGeneratorNinja.h"
+#include "compilationDatabase.h"
+#include "includeGraph.h"
+#include "fileWatcher.h"
+#include "profiler.h"
 
 //--
 
@@ -181,77 +186,98 @@ bool RunInteractiveConfig(Configuration& cfg)
 
 //--
 
-ToolMake::ToolMake()
-{}
-
-int ToolMake::run(const char* argv0, const Commandline& cmdline)
+static bool ScanStructure(const Configuration& config, ProjectStructure& structure, TaskPool& pool, const fs::path& snapshotPath, bool allowSnapshot)
 {
-    //--
-
-    Configuration config;
-    if (!config.parseOptions(argv0, cmdline)) {
-        std::cout << "Invalid/incomplete configuration\n";
-        return -1;
-    }
-
-    if (cmdline.has("interactive"))
-        if (!RunInteractiveConfig(config))
-            return false;
-
-    if (!config.parsePaths(argv0, cmdline)) {
-        std::cout << "Invalid/incomplete configuration\n";
-        return -1;
-    }
-
-    //--
+    ProfileScope profile("scan");
 
-    ProjectStructure structure;
+    if (allowSnapshot && !config.force && structure.loadSnapshot(snapshotPath, config, pool))
+        return true;
 
     if (!config.engineSourcesPath.empty())
-        structure.scanProjects(ProjectGroupType::Engine, config.engineSourcesPath);
+        structure.scanProjects(ProjectGroupType::Engine, config.engineSourcesPath, pool);
 
     /*if (!config.engineScriptPath.empty())
         structure.scanScriptProjects(ProjectGroupType::MonoScripts, config.engineScriptPath / "src");*/
 
     if (!config.projectSourcesPath.empty())
-        structure.scanProjects(ProjectGroupType::User, config.projectSourcesPath);
+        structure.scanProjects(ProjectGroupType::User, config.projectSourcesPath, pool);
 
     uint32_t totalFiles = 0;
-    if (!structure.scanContent(totalFiles))
-        return -1;
+    if (!structure.scanContent(totalFiles, pool))
+        return false;
 
-    if (!structure.setupProjects(config))
-        return -1;
+    if (!structure.setupProjects(config, pool))
+        return false;
+
+    if (!structure.saveSnapshot(snapshotPath, config, std::cout))
+        std::cout << "Failed to save project structure snapshot\n";
+
+    return true;
+}
+
+// in the watch mode the generator is kept between the rounds and only the projects affected by the changed ones are generated again
+static bool GenerateSolution(const Configuration& config, ProjectStructure& structure, ProjectGenerator& codeGenerator, TaskPool& pool, const std::unordered_set<std::string>* changedProjects = nullptr)
+{
+    ProfileScope profile("generate");
+
+    uint32_t totalFiles = 0;
+    for (const auto* project : structure.projects)
+        totalFiles += (uint32_t)project->files.size();
 
     if (!structure.resolveProjectDependencies(config))
-        return -1;
+        return false;
 
     if (config.build == BuildType::Standalone)
         if (!structure.makeModules(config))
-            return -1;
+            return false;
 
     std::cout << "Found " << totalFiles << " total files across " << structure.projects.size() << " projects\n";
 
     if (!structure.deployFiles(config))
-        return -1;
+        return false;
 
-    ProjectGenerator codeGenerator(config);
-    if (!codeGenerator.extractProjects(structure))
-        return -1;
+    codeGenerator.manifestPath = config.solutionPath / "generated.manifest";
+    codeGenerator.streaming = config.streaming;
 
-    if (!codeGenerator.generateAutomaticCode())
-        return -1;
+    if (changedProjects)
+    {
+        if (!codeGenerator.refreshProjects(structure, *changedProjects))
+            return false;
+    }
+    else
+    {
+        // forced run compares all outputs with their actual content
+        if (config.force)
+        {
+            std::error_code ec;
+            fs::remove(codeGenerator.manifestPath, ec);
+        }
 
-    if (!codeGenerator.generateExtraCode())
-        return -1;
+        if (!codeGenerator.extractProjects(structure))
+            return false;
+    }
+
+    // only the original files are known at this point, that's all the sources include anyway
+    if (config.autoPch)
+    {
+        IncludeGraph graph(config, codeGenerator);
+        graph.build(pool);
+        graph.selectPrecompiledHeaders(pool);
+    }
+
+    if (!codeGenerator.generateAutomaticCode(pool))
+        return false;
+
+    if (!codeGenerator.generateExtraCode(pool))
+        return false;
 
     if (config.generator == GeneratorType::VisualStudio19 || config.generator == GeneratorType::VisualStudio22)
     {
         SolutionGeneratorVS gen(config, codeGenerator);
         if (!gen.generateSolution())
-            return -1;
+            return false;
         if (!gen.generateProjects())
-            return -1;
+            return false;
     }
     else if (config.generator == GeneratorType::CMake)
     {
@@ -264,15 +290,220 @@ int ToolMake::run(const char* argv0, const Commandline& cmdline)
 
         SolutionGeneratorCMAKE gen(config, codeGenerator);
         if (!gen.generateSolution())
-            return -1;
+            return false;
         if (!gen.generateProjects())
+            return false;
+    }
+    else if (config.generator == GeneratorType::Ninja)
+    {
+        SolutionGeneratorNinja gen(config, codeGenerator);
+        if (!gen.generateSolution())
+            return false;
+        if (!gen.generateProjects())
+            return false;
+    }
+
+    {
+        CompilationDatabaseGenerator gen(config, codeGenerator);
+        if (!gen.generateDatabase())
+            return false;
+    }
+
+    if (!codeGenerator.saveFiles(pool))
+        return false;
+
+    // needs all generated files on disk
+    if (config.includeGraph)
+    {
+        IncludeGraph graph(config, codeGenerator);
+        graph.build(pool);
+        if (!graph.save(config.solutionPath / "include_graph.json"))
+            return false;
+    }
+
+    codeGenerator.releaseFiles();
+    return true;
+}
+
+static void CollectWatchedDirectories(const ProjectStructure& structure, std::vector<fs::path>& outDirectories)
+{
+    outDirectories.clear();
+    for (const auto& dir : structure.scannedDirectories)
+        outDirectories.push_back(dir.first);
+}
+
+static bool IsRelevantChange(const FileWatcher::Event& evt)
+{
+    if (evt.type == FileWatcherEventType::Overflow || evt.isDirectory || evt.name == "build.lua")
+        return true;
+
+    // file content does not matter for the project files, the BUILD file is written by us
+    return evt.type != FileWatcherEventType::Modified && evt.name != "BUILD";
+}
+
+static bool CollectChangedProjects(const ProjectStructure& structure, const std::vector<FileWatcher::Event>& events, std::vector<ProjectStructure::ProjectInfo*>& outProjects)
+{
+    for (const auto& evt : events)
+    {
+        if (!IsRelevantChange(evt))
+            continue;
+
+        // any change in the directory layout or the set of the build scripts may add or remove projects
+        if (evt.type == FileWatcherEventType::Overflow || evt.isDirectory)
+            return false;
+        if (evt.name == "build.lua" && evt.type != FileWatcherEventType::Modified)
+            return false;
+
+        if (auto* project = structure.findProjectForPath(evt.directoryPath))
+            PushBackUnique(outProjects, project);
+    }
+
+    return true;
+}
+
+static void SaveProfile(const std::string& profilePath)
+{
+    if (!profilePath.empty())
+        if (!Profiler::Save(profilePath))
+            std::cout << "Failed to save profile to '" << profilePath << "'\n";
+}
+
+static int RunWatchMode(const Configuration& config, TaskPool& pool, const fs::path& snapshotPath, ProjectStructure* structure, ProjectGenerator* codeGenerator, bool valid, const std::string& profilePath)
+{
+    FileWatcher watcher;
+    if (!watcher.valid())
+    {
+        std::cout << "Watch mode is not supported on this platform\n";
+        return -1;
+    }
+
+    std::vector<fs::path> directories;
+    CollectWatchedDirectories(*structure, directories);
+
+    watcher.syncDirectories(directories);
+    std::cout << "Watching " << directories.size() << " directories for changes...\n";
+
+    for (;;)
+    {
+        std::vector<FileWatcher::Event> events;
+        if (!watcher.waitForChanges(events, 200))
+        {
+            std::cout << "Failed to wait for file system changes\n";
             return -1;
+        }
+
+        if (std::none_of(events.begin(), events.end(), IsRelevantChange))
+            continue;
+
+        // the structure and the generated projects stay from the previous round, only the changed projects are processed again
+        // failed round can't be continued from and the modules of the standalone build are always made from the whole structure
+        std::vector<ProjectStructure::ProjectInfo*> changedProjects;
+        bool fullRescan = !valid || config.build == BuildType::Standalone;
+        if (!fullRescan)
+            fullRescan = !CollectChangedProjects(*structure, events, changedProjects);
+
+        if (!fullRescan && changedProjects.empty())
+            continue;
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        if (fullRescan)
+        {
+            std::cout << "Project layout has changed, rescanning\n";
+
+            delete codeGenerator;
+            delete structure;
+
+            structure = new ProjectStructure();
+            codeGenerator = new ProjectGenerator(config);
+
+            valid = ScanStructure(config, *structure, pool, snapshotPath, false);
+            valid = valid && GenerateSolution(config, *structure, *codeGenerator, pool);
+        }
+        else
+        {
+            std::unordered_set<std::string> changedNames;
+            for (const auto* project : changedProjects)
+                changedNames.insert(project->mergedName);
+
+            valid = structure->refreshProjects(changedProjects, config, pool);
+
+            if (valid && !structure->saveSnapshot(snapshotPath, config, std::cout))
+                std::cout << "Failed to save project structure snapshot\n";
+
+            valid = valid && GenerateSolution(config, *structure, *codeGenerator, pool, &changedNames);
+        }
+
+        CollectWatchedDirectories(*structure, directories);
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+        if (valid)
+            std::cout << "Regenerated in " << elapsed << " ms\n";
+        else
+            std::cout << "Regeneration failed, waiting for fixes\n";
+
+        SaveProfile(profilePath);
+
+        watcher.syncDirectories(directories);
+        std::cout << "Watching " << directories.size() << " directories for changes...\n";
     }
+}
+
+//--
 
-    if (!codeGenerator.saveFiles())
+ToolMake::ToolMake()
+{}
+
+int ToolMake::run(const char* argv0, const Commandline& cmdline)
+{
+    //--
+
+    Configuration config;
+    if (!config.parseOptions(argv0, cmdline)) {
+        std::cout << "Invalid/incomplete configuration\n";
         return -1;
+    }
+
+    if (cmdline.has("interactive"))
+        if (!RunInteractiveConfig(config))
+            return false;
+
+    if (!config.parsePaths(argv0, cmdline)) {
+        std::cout << "Invalid/incomplete configuration\n";
+        return -1;
+    }
+
+    //--
+
+    // -profile=trace.json records the time spent in each phase, script and saved file
+    const auto profilePath = cmdline.get("profile");
+    if (!profilePath.empty())
+        Profiler::Start();
+
+    TaskPool pool(config.numThreads);
+
+    // the snapshot is only valid for the same configuration, it's rejected if anything in the source tree has changed
+    const auto snapshotPath = config.solutionPath / "structure.snapshot";
+
+    const auto watch = cmdline.has("watch");
+
+    // the watch mode takes over both and keeps them between the rounds
+    auto* structure = new ProjectStructure();
+    auto* codeGenerator = new ProjectGenerator(config);
+
+    auto valid = ScanStructure(config, *structure, pool, snapshotPath, true);
+    valid = valid && GenerateSolution(config, *structure, *codeGenerator, pool);
+
+    SaveProfile(profilePath);
+
+    if (!watch)
+    {
+        delete codeGenerator;
+        delete structure;
+        return valid ? 0 : -1;
+    }
 
-    return 0;
+    return RunWatchMode(config, pool, snapshotPath, structure, codeGenerator, valid, profilePath);
 }
 
 //--
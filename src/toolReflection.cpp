@@ -111,18 +111,7 @@ bool ProjectReflection::tokenizeFiles()
     bool valid = true;
 
     for (auto* file : files)
-    {
-        std::string content;
-        if (LoadFileToString(file->absoluitePath, content))
-        {
-            valid &= file->tokenized.tokenize(content);
-        }
-        else
-        {
-            std::cout << "Failed to load content of file " << file->absoluitePath << "\n";
-            valid = false;
-        }
-    }
+        valid &= file->tokenized.tokenizeFile(file->absoluitePath);
 
     return valid;
 }
@@ -201,7 +190,7 @@ static void ExtractDeclarations(const ProjectReflection::RefelctionProject& p, s
         });
 }
 
-bool ProjectReflection::generateReflectionForProject(const RefelctionProject& p, std::stringstream& f) const
+bool ProjectReflection::generateReflectionForProject(const RefelctionProject& p, StringBuilder& f) const
 {
     writeln(f, "/// Inferno Engine v4 by Tomasz \"RexDex\" Jonarski");
     writeln(f, "/// RTTI Glue Code Generator is under MIT License");
@@ -311,11 +300,12 @@ int ToolReflection::run(const char* argv0, const Commandline& cmdline)
 
 	std::cout << "Generating reflection files...\n";
 
+    TaskPool pool;
     FileGenerator files;
 	if (!reflection.generateReflection(files))
 		return -5;
 
-    if (!files.saveFiles())
+    if (!files.saveFiles(pool))
         return -6;
 
 	return 0;
@@ -35,7 +35,7 @@ struct ProjectReflection
     bool generateReflection(FileGenerator& files) const;
 
 private:
-    bool generateReflectionForProject(const RefelctionProject& p, std::stringstream& f) const;
+    bool generateReflectionForProject(const RefelctionProject& p, StringBuilder& f) const;
 };
 
 //--
@@ -65,6 +65,7 @@ int ToolScriptMake::run(const char* argv0, const Commandline& cmdline)
 
     //--
 
+    TaskPool pool;
     FileGenerator files;
 
     /*if (generator == "vs")
@@ -74,7 +75,7 @@ int ToolScriptMake::run(const char* argv0, const Commandline& cmdline)
         gen.generateSolution();
     }*/
 
-    if (!files.saveFiles())
+    if (!files.saveFiles(pool))
         return false;
 
     return true;
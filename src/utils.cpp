@@ -10,6 +10,15 @@
 #define sprintf_s(x, size, txt, ...) sprintf(x, txt, __VA_ARGS__)
 #endif
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 //--
 
 namespace prv
@@ -921,25 +930,79 @@ bool LoadFileToString(const fs::path& path, std::string& outText)
     }
 }
 
-bool SaveFileFromString(const fs::path& path, std::string_view txt, bool force /*= false*/, uint32_t* outCounter, fs::file_time_type customTime /*= fs::file_time_type()*/)
+// files are written in text mode, on some platforms that turns "\n" into "\r\n"
+static bool EqualsIgnoringLineEndings(std::string_view fileContent, const std::vector<std::string_view>& parts)
+{
+    size_t i = 0;
+    for (const auto txt : parts)
+    {
+        size_t j = 0;
+        while (j < txt.length())
+        {
+            if (i == fileContent.length())
+            {
+                return false;
+            }
+            else if (fileContent[i] == txt[j])
+            {
+                ++i;
+                ++j;
+            }
+            else if (fileContent[i] == '\r' && txt[j] == '\n' && (i + 1) < fileContent.length() && fileContent[i + 1] == '\n')
+            {
+                ++i;
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+
+    return (i == fileContent.length());
+}
+
+bool SaveFileFromString(const fs::path& path, std::string_view txt, bool force /*= false*/, uint32_t* outCounter, fs::file_time_type customTime /*= fs::file_time_type()*/, OutputManifest* manifest /*= nullptr*/)
+{
+    return SaveFileFromString(path, txt, std::cout, force, outCounter, customTime, manifest);
+}
+
+static bool SaveFileFromParts(const fs::path& path, const std::vector<std::string_view>& parts, std::ostream& log, bool force, uint32_t* outCounter, fs::file_time_type customTime, OutputManifest* manifest)
 {
-    std::string newContent(txt);
+    const auto contentHash = manifest ? HashContent(parts) : 0;
 
     if (!force)
     {
-        std::string currentContent;
-        if (LoadFileToString(path, currentContent))
+        if (manifest && manifest->isUpToDate(path, contentHash))
         {
-            if (currentContent == txt)
+            if (customTime != fs::file_time_type())
+            {
+                fs::last_write_time(path, customTime);
+                manifest->update(path, contentHash);
+            }
+
+            return true;
+        }
+
+        FileView currentContent;
+        if (currentContent.open(path))
+        {
+            const auto same = EqualsIgnoringLineEndings(currentContent.view(), parts);
+            currentContent.close(); // mapped file can't be overwritten on Windows
+
+            if (same)
             {
                 if (customTime != fs::file_time_type())
                     fs::last_write_time(path, customTime);
 
+                if (manifest)
+                    manifest->update(path, contentHash);
+
                 return true;
             }
         }
 
-        std::cout << "File " << path << " has changed and has to be saved\n";
+        log << "File " << path << " has changed and has to be saved\n";
     }
 
     {
@@ -947,23 +1010,565 @@ bool SaveFileFromString(const fs::path& path, std::string_view txt, bool force /
         fs::create_directories(path.parent_path(), ec);
     }
 
-    try
+    // the temporary file is placed next to the target so the rename does not cross file systems
+    auto tempPath = path;
+    tempPath += ".tmp";
+
     {
-        std::ofstream file(path);
-        file << txt;
+        std::ofstream file(tempPath);
+        for (const auto txt : parts)
+            file << txt;
+        file.close();
+
+        if (file.fail())
+        {
+            log << "Error writing file " << tempPath << "\n";
+
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return false;
+        }
     }
-    catch (std::exception& e)
+
     {
-        std::cout << "Error writing file " << path << ": " << e.what() << "\n";
-        return false;
+        std::error_code ec;
+        fs::rename(tempPath, path, ec);
+        if (ec)
+        {
+            log << "Error replacing file " << path << ": " << ec.message() << "\n";
+
+            fs::remove(tempPath, ec);
+            return false;
+        }
     }
 
+    if (manifest)
+        manifest->update(path, contentHash);
+
     if (outCounter)
         (*outCounter) += 1;
 
     return true;
 }
 
+bool SaveFileFromString(const fs::path& path, std::string_view txt, std::ostream& log, bool force /*= false*/, uint32_t* outCounter, fs::file_time_type customTime /*= fs::file_time_type()*/, OutputManifest* manifest /*= nullptr*/)
+{
+    return SaveFileFromParts(path, { txt }, log, force, outCounter, customTime, manifest);
+}
+
+bool SaveFileFromString(const fs::path& path, const StringBuilder& txt, std::ostream& log, bool force /*= false*/, uint32_t* outCounter, fs::file_time_type customTime /*= fs::file_time_type()*/, OutputManifest* manifest /*= nullptr*/)
+{
+    std::vector<std::string_view> parts;
+    txt.parts(parts);
+
+    return SaveFileFromParts(path, parts, log, force, outCounter, customTime, manifest);
+}
+
+FileView::FileView()
+{}
+
+FileView::~FileView()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool FileView::open(const fs::path& path)
+{
+    close();
+
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // empty files can't be mapped
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return true;
+    }
+
+    // the mapping keeps its own reference to the file, many views may be alive at once so don't hold the handles
+    m_mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+
+    if (!m_mapping)
+        return false;
+
+    m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void FileView::close()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+}
+
+#else
+
+bool FileView::open(const fs::path& path)
+{
+    close();
+
+    const auto file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        ::close(file);
+        return false;
+    }
+
+    // empty files can't be mapped
+    if (info.st_size == 0)
+    {
+        ::close(file);
+        return true;
+    }
+
+    // the mapping does not need the descriptor, many views may be alive at once so don't hold it
+    auto* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = (const char*)data;
+    m_size = (size_t)info.st_size;
+    return true;
+}
+
+void FileView::close()
+{
+    if (m_data)
+        munmap((void*)m_data, m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+//--
+
+bool SaveBinaryFile(const fs::path& path, std::string_view data, std::ostream& log, std::string_view tempSuffix /*= ".tmp"*/)
+{
+    {
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+    }
+
+    // same scheme as the text files, the target is never seen partially written
+    auto tempPath = path;
+    tempPath += std::string(tempSuffix);
+
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+        file.close();
+
+        if (file.fail())
+        {
+            log << "Error writing file " << tempPath << "\n";
+
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    {
+        std::error_code ec;
+        fs::rename(tempPath, path, ec);
+        if (ec)
+        {
+            log << "Error replacing file " << path << ": " << ec.message() << "\n";
+
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint64_t HashContentUpdate(uint64_t hash, std::string_view data)
+{
+    for (const auto ch : data)
+    {
+        hash ^= (uint8_t)ch;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+uint64_t HashContent(std::string_view data)
+{
+    return HashContentUpdate(0xcbf29ce484222325ULL, data);
+}
+
+uint64_t HashContent(const std::vector<std::string_view>& parts)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto part : parts)
+        hash = HashContentUpdate(hash, part);
+
+    return hash;
+}
+
+//--
+
+StringBuilder::StringBuilder()
+{}
+
+StringBuilder::~StringBuilder()
+{}
+
+StringBuilder::Block& StringBuilder::reserve(size_t length)
+{
+    if (!m_blocks.empty())
+    {
+        auto& last = m_blocks.back();
+        if (last.capacity - last.size >= length)
+            return last;
+    }
+
+    // blocks grow with the content so small files stay small and big files need few blocks
+    auto capacity = m_blocks.empty() ? MIN_BLOCK_SIZE : std::min<size_t>(m_blocks.back().capacity * 2, MAX_BLOCK_SIZE);
+    capacity = std::max<size_t>(capacity, length);
+
+    Block block;
+    block.data.reset(new char[capacity]);
+    block.capacity = capacity;
+    m_blocks.push_back(std::move(block));
+    return m_blocks.back();
+}
+
+void StringBuilder::append(const char* data, size_t length)
+{
+    m_length += length;
+
+    while (length > 0)
+    {
+        // fill the rest of the current block before starting a new one
+        auto& block = reserve(1);
+
+        const auto count = std::min<size_t>(length, block.capacity - block.size);
+        memcpy(block.data.get() + block.size, data, count);
+        block.size += count;
+
+        data += count;
+        length -= count;
+    }
+}
+
+void StringBuilder::appendf(const char* txt, ...)
+{
+    va_list args;
+    va_start(args, txt);
+    appendfv(txt, args);
+    va_end(args);
+}
+
+void StringBuilder::appendfv(const char* txt, va_list args)
+{
+    // try to format directly into the free space of the current block
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+
+    auto* block = m_blocks.empty() ? &reserve(256) : &m_blocks.back();
+    auto length = vsnprintf(block->data.get() + block->size, block->capacity - block->size, txt, argsCopy);
+    va_end(argsCopy);
+
+    if (length < 0)
+        return;
+
+    // formatted text (with the terminating zero) did not fit, format again into a block that is big enough
+    if ((size_t)length >= block->capacity - block->size)
+    {
+        block = &reserve(length + 1);
+        vsnprintf(block->data.get() + block->size, block->capacity - block->size, txt, args);
+    }
+
+    block->size += length;
+    m_length += length;
+}
+
+void StringBuilder::parts(std::vector<std::string_view>& outParts) const
+{
+    outParts.reserve(outParts.size() + m_blocks.size());
+
+    for (const auto& block : m_blocks)
+        if (block.size)
+            outParts.emplace_back(block.data.get(), block.size);
+}
+
+std::string StringBuilder::str() const
+{
+    std::string ret;
+    ret.reserve(m_length);
+
+    for (const auto& block : m_blocks)
+        ret.append(block.data.get(), block.size);
+
+    return ret;
+}
+
+void StringBuilder::clear()
+{
+    m_blocks.clear();
+    m_blocks.shrink_to_fit();
+    m_length = 0;
+}
+
+//--
+
+static const uint32_t MANIFEST_MAGIC = 0x4D4F4C42; // "BLOM"
+static const uint32_t MANIFEST_VERSION = 1;
+
+// size and modification time of the file, both from a single stat call
+static bool GetFileStamp(const fs::path& path, uint64_t& outSize, uint64_t& outTime)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+        return false;
+
+    outSize = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    outTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat info;
+    if (0 != stat(path.c_str(), &info))
+        return false;
+
+    outSize = (uint64_t)info.st_size;
+    outTime = (uint64_t)info.st_mtim.tv_sec * 1000000000ULL + (uint64_t)info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool OutputManifest::load(const fs::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    m_entries.clear();
+
+    FileView file;
+    if (!file.open(path))
+        return false;
+
+    BinaryReader r(file.view());
+    if (r.readUint32() != MANIFEST_MAGIC || r.readUint32() != MANIFEST_VERSION)
+        return false;
+
+    const auto count = r.readUint32();
+    for (uint32_t i = 0; i < count && r.valid(); ++i)
+    {
+        auto key = r.readString();
+
+        Entry entry;
+        entry.contentHash = r.readUint64();
+        entry.size = r.readUint64();
+        entry.time = r.readUint64();
+        m_entries[std::move(key)] = entry;
+    }
+
+    if (!r.valid())
+    {
+        m_entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool OutputManifest::save(const fs::path& path, std::ostream& log) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    // sorted so the file does not change between runs that produced the same outputs
+    std::vector<const std::pair<const std::string, Entry>*> entries;
+    for (const auto& it : m_entries)
+        if (it.second.used)
+            entries.push_back(&it);
+
+    std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    BinaryWriter w;
+    w.writeUint32(MANIFEST_MAGIC);
+    w.writeUint32(MANIFEST_VERSION);
+    w.writeUint32((uint32_t)entries.size());
+
+    for (const auto* it : entries)
+    {
+        w.writeString(it->first);
+        w.writeUint64(it->second.contentHash);
+        w.writeUint64(it->second.size);
+        w.writeUint64(it->second.time);
+    }
+
+    return SaveBinaryFile(path, w.data(), log);
+}
+
+bool OutputManifest::isUpToDate(const fs::path& path, uint64_t contentHash) const
+{
+    Entry entry;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        const auto it = m_entries.find(path.u8string());
+        if (it == m_entries.end() || it->second.contentHash != contentHash)
+            return false;
+
+        it->second.used = true;
+        entry = it->second;
+    }
+
+    uint64_t size = 0, time = 0;
+    if (!GetFileStamp(path, size, time))
+        return false;
+
+    return entry.size == size && entry.time == time;
+}
+
+void OutputManifest::update(const fs::path& path, uint64_t contentHash)
+{
+    Entry entry;
+    entry.contentHash = contentHash;
+    entry.used = true;
+
+    if (!GetFileStamp(path, entry.size, entry.time))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries[path.u8string()] = entry;
+}
+
+//--
+
+void BinaryWriter::writeUint8(uint8_t value)
+{
+    m_data.push_back((char)value);
+}
+
+void BinaryWriter::writeUint32(uint32_t value)
+{
+    m_data.append((const char*)&value, sizeof(value));
+}
+
+void BinaryWriter::writeUint64(uint64_t value)
+{
+    m_data.append((const char*)&value, sizeof(value));
+}
+
+void BinaryWriter::writeString(std::string_view value)
+{
+    writeUint32((uint32_t)value.length());
+    m_data.append(value.data(), value.length());
+}
+
+void BinaryWriter::writePath(const fs::path& value)
+{
+    writeString(value.u8string());
+}
+
+void BinaryWriter::writeTime(fs::file_time_type value)
+{
+    writeUint64((uint64_t)value.time_since_epoch().count());
+}
+
+//--
+
+BinaryReader::BinaryReader(std::string_view data)
+    : m_cur(data.data())
+    , m_end(data.data() + data.length())
+{}
+
+bool BinaryReader::readBytes(void* outData, size_t size)
+{
+    if (!m_valid || (size_t)(m_end - m_cur) < size)
+    {
+        m_valid = false;
+        memset(outData, 0, size);
+        return false;
+    }
+
+    memcpy(outData, m_cur, size);
+    m_cur += size;
+    return true;
+}
+
+uint8_t BinaryReader::readUint8()
+{
+    uint8_t ret = 0;
+    readBytes(&ret, sizeof(ret));
+    return ret;
+}
+
+uint32_t BinaryReader::readUint32()
+{
+    uint32_t ret = 0;
+    readBytes(&ret, sizeof(ret));
+    return ret;
+}
+
+uint64_t BinaryReader::readUint64()
+{
+    uint64_t ret = 0;
+    readBytes(&ret, sizeof(ret));
+    return ret;
+}
+
+std::string BinaryReader::readString()
+{
+    const auto length = readUint32();
+    if (!m_valid || (size_t)(m_end - m_cur) < length)
+    {
+        m_valid = false;
+        return std::string();
+    }
+
+    std::string ret(m_cur, length);
+    m_cur += length;
+    return ret;
+}
+
+fs::path BinaryReader::readPath()
+{
+    return fs::u8path(readString());
+}
+
+fs::file_time_type BinaryReader::readTime()
+{
+    return fs::file_time_type(fs::file_time_type::duration((fs::file_time_type::rep)readUint64()));
+}
+
 //--
 
 void SplitString(std::string_view txt, std::string_view delim, std::vector<std::string_view>& outParts)
@@ -1033,22 +1638,96 @@ std::string ToUpper(std::string_view txt)
     return ret;
 }
 
-void writeln(std::stringstream& s, std::string_view txt)
+std::string JsonString(std::string_view txt)
 {
-    s << txt;
-    s << "\n";
+    std::string ret;
+    ret.reserve(txt.length() + 2);
+
+    ret += '\"';
+
+    for (const auto ch : txt)
+    {
+        if (ch == '\"' || ch == '\\')
+        {
+            ret += '\\';
+            ret += ch;
+        }
+        else if (ch == '\n')
+        {
+            ret += "\\n";
+        }
+        else if (ch == '\t')
+        {
+            ret += "\\t";
+        }
+        else if (ch == '\r')
+        {
+            ret += "\\r";
+        }
+        else if (ch == '\b')
+        {
+            ret += "\\b";
+        }
+        else if (ch == '\f')
+        {
+            ret += "\\f";
+        }
+        else if ((uint8_t)ch < 32)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", (unsigned)(uint8_t)ch);
+            ret += code;
+        }
+        else
+        {
+            ret += ch;
+        }
+    }
+
+    ret += '\"';
+    return ret;
 }
 
-void writelnf(std::stringstream& s, const char* txt, ...)
+void CollectDefineString(std::vector<std::pair<std::string, std::string>>& ar, std::string_view name, std::string_view value)
+{
+    for (auto& entry : ar)
+    { 
+        if (entry.first == name)
+        {
+            entry.second = value;
+            return;
+        }
+    }
+
+    ar.emplace_back(std::make_pair(name, value));
+}
+
+void CollectDefineStrings(std::vector<std::pair<std::string, std::string>>& ar, const std::vector<std::pair<std::string, std::string>>& defs)
+{
+    for (const auto& def : defs)
+        CollectDefineString(ar, def.first, def.second);
+}
+
+const char* EnvironmentTool(const char* name, const char* defaultTool)
+{
+    const char* tool = getenv(name);
+    return (tool && *tool) ? tool : defaultTool;
+}
+
+void writeln(StringBuilder& s, std::string_view txt)
+{
+    s.append(txt);
+    s.append("\n", 1);
+}
+
+void writelnf(StringBuilder& s, const char* txt, ...)
 {
-    char buffer[8192];
     va_list args;
     va_start(args, txt);
-    vsprintf_s(buffer, sizeof(buffer), txt, args);
+    s.appendfv(txt, args);
     va_end(args);
 
-    s << buffer;
-    s << "\n";
+    s.append("\n", 1);
 }
 
 std::string GuidFromText(std::string_view txt)
@@ -1125,6 +1804,11 @@ bool ParseGeneratorType(std::string_view txt, GeneratorType& outType)
     return ParseEnumValue(txt, outType);
 }
 
+bool ParseProfileGuidedStage(std::string_view txt, ProfileGuidedStage& outType)
+{
+    return ParseEnumValue(txt, outType);
+}
+
 
 //--
 
@@ -1181,12 +1865,32 @@ std::string_view NameEnumOption(GeneratorType type)
     case GeneratorType::VisualStudio19: return "vs2019"; 
     case GeneratorType::VisualStudio22: return "vs2022";
     case GeneratorType::CMake: return "cmake";
+    case GeneratorType::Ninja: return "ninja";
+    }
+    return "";
+}
+
+std::string_view NameEnumOption(ProfileGuidedStage type)
+{
+    switch (type)
+    {
+    case ProfileGuidedStage::None: return "none";
+    case ProfileGuidedStage::Instrument: return "instrument";
+    case ProfileGuidedStage::Optimize: return "optimize";
+    case ProfileGuidedStage::MAX: break;
     }
     return "";
 }
 
 //--
 
+fs::file_time_type GetFileTime(const fs::path& path)
+{
+    std::error_code ec;
+    const auto time = fs::last_write_time(path, ec);
+    return ec ? fs::file_time_type() : time;
+}
+
 bool IsFileSourceNewer(const fs::path& source, const fs::path& target)
 {
     try
@@ -80,9 +80,184 @@ public:
 
 //--
 
+// Read-only view of the file content mapped directly into memory, the content is not copied
+// NOTE: the view is the raw file content, no line ending conversion is done
+class FileView
+{
+public:
+    FileView();
+    FileView(const FileView& other) = delete;
+    FileView& operator=(const FileView& other) = delete;
+    ~FileView();
+
+    inline std::string_view view() const { return std::string_view(m_data, m_size); }
+
+    bool open(const fs::path& path); // fails if the file does not exist or can't be mapped
+    void close();
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_mapping = nullptr; // the file handle is closed right after the mapping is created
+#endif
+};
+
+//--
+
+class BinaryWriter
+{
+public:
+    inline const std::string& data() const { return m_data; }
+
+    void writeUint8(uint8_t value);
+    void writeUint32(uint32_t value);
+    void writeUint64(uint64_t value);
+    void writeString(std::string_view value);
+    void writePath(const fs::path& value);
+    void writeTime(fs::file_time_type value);
+
+private:
+    std::string m_data;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader(std::string_view data);
+
+    inline bool valid() const { return m_valid; } // false if we tried to read past the end of data
+
+    uint8_t readUint8();
+    uint32_t readUint32();
+    uint64_t readUint64();
+    std::string readString();
+    fs::path readPath();
+    fs::file_time_type readTime();
+
+private:
+    const char* m_cur;
+    const char* m_end;
+    bool m_valid = true;
+
+    bool readBytes(void* outData, size_t size);
+};
+
+//--
+
+// Text builder for the generated files, appends into a list of growing memory blocks so the content is never moved or concatenated
+// The blocks are handed directly to the hashing and saving of the file
+class StringBuilder
+{
+public:
+    StringBuilder();
+    ~StringBuilder();
+
+    StringBuilder(const StringBuilder& other) = delete;
+    StringBuilder& operator=(const StringBuilder& other) = delete;
+
+    inline size_t length() const { return m_length; }
+    inline bool empty() const { return m_length == 0; }
+
+    //--
+
+    void append(const char* data, size_t length);
+    inline void append(std::string_view txt) { append(txt.data(), txt.length()); }
+
+    // printf-like formatting directly into the block memory, no length limit
+    void appendf(const char* txt, ...);
+    void appendfv(const char* txt, va_list args);
+
+    inline StringBuilder& operator<<(std::string_view txt) { append(txt); return *this; }
+    inline StringBuilder& operator<<(const std::string& txt) { append(txt); return *this; }
+    inline StringBuilder& operator<<(const char* txt) { append(std::string_view(txt)); return *this; }
+    inline StringBuilder& operator<<(char ch) { append(&ch, 1); return *this; }
+
+    template< typename T, typename = std::enable_if_t<std::is_integral_v<T>> >
+    inline StringBuilder& operator<<(T value)
+    {
+        char buffer[32];
+        const auto ret = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        append(buffer, ret.ptr - buffer);
+        return *this;
+    }
+
+    //--
+
+    // get the content as a list of continuous parts, valid until next append
+    void parts(std::vector<std::string_view>& outParts) const;
+
+    // get the content as a single string, makes a copy
+    std::string str() const;
+
+    // remove all content and free the memory
+    void clear();
+
+private:
+    static const size_t MIN_BLOCK_SIZE = 4096;
+    static const size_t MAX_BLOCK_SIZE = 1 << 20;
+
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_length = 0;
+
+    Block& reserve(size_t length); // block with at least given free space
+};
+
+//--
+
+// Persistent record of the generated output files: content hash, size and modification time of every file we saved
+// Allows to confirm that an output file is still up to date with a single stat instead of reading it back
+class OutputManifest
+{
+public:
+    bool load(const fs::path& path);
+    bool save(const fs::path& path, std::ostream& log) const; // only the files checked or updated since load are kept
+
+    // check if the file on disk is still the one we've written with given content, does not read the file
+    bool isUpToDate(const fs::path& path, uint64_t contentHash) const;
+
+    // remember the current state of the file on disk, called after the file was saved or confirmed by full comparison
+    void update(const fs::path& path, uint64_t contentHash);
+
+private:
+    struct Entry
+    {
+        uint64_t contentHash = 0;
+        uint64_t size = 0;
+        uint64_t time = 0;
+        mutable bool used = false;
+    };
+
+    mutable std::mutex m_lock;
+    std::unordered_map<std::string, Entry> m_entries;
+};
+
+//--
+
 extern bool LoadFileToString(const fs::path& path, std::string& outText);
 
-extern bool SaveFileFromString(const fs::path& path, std::string_view txt, bool force = false, uint32_t* outCounter=nullptr, fs::file_time_type customTime = fs::file_time_type());
+extern bool SaveFileFromString(const fs::path& path, std::string_view txt, bool force = false, uint32_t* outCounter=nullptr, fs::file_time_type customTime = fs::file_time_type(), OutputManifest* manifest = nullptr);
+
+// same as above but messages go to given log instead of std::cout, allows to save files in parallel and report in fixed order
+// changed files are written to a temporary file first and renamed into place so nobody can see a partially written file
+extern bool SaveFileFromString(const fs::path& path, std::string_view txt, std::ostream& log, bool force = false, uint32_t* outCounter = nullptr, fs::file_time_type customTime = fs::file_time_type(), OutputManifest* manifest = nullptr);
+
+extern bool SaveFileFromString(const fs::path& path, const StringBuilder& txt, std::ostream& log, bool force = false, uint32_t* outCounter = nullptr, fs::file_time_type customTime = fs::file_time_type(), OutputManifest* manifest = nullptr);
+
+// written to a temporary file and renamed into place, files written by several threads at once need different suffixes
+extern bool SaveBinaryFile(const fs::path& path, std::string_view data, std::ostream& log, std::string_view tempSuffix = ".tmp");
+
+extern uint64_t HashContent(std::string_view data); // stable across runs (FNV-1a), safe to store on disk
+
+extern uint64_t HashContent(const std::vector<std::string_view>& parts); // same value as the hash of the concatenated parts
 
 //--
 
@@ -100,9 +275,17 @@ extern std::string MakeGenericPath(std::string_view txt);
 
 extern std::string ToUpper(std::string_view txt);
 
-extern void writeln(std::stringstream& s, std::string_view txt);
+extern std::string JsonString(std::string_view txt); // quoted and escaped
+
+extern void CollectDefineString(std::vector<std::pair<std::string, std::string>>& ar, std::string_view name, std::string_view value); // replaces the value of a define that is already there
+
+extern void CollectDefineStrings(std::vector<std::pair<std::string, std::string>>& ar, const std::vector<std::pair<std::string, std::string>>& defs);
+
+extern const char* EnvironmentTool(const char* name, const char* defaultTool); // tool from the environment variable (CC, CXX, AR), default one if not set
+
+extern void writeln(StringBuilder& s, std::string_view txt);
 
-extern void writelnf(std::stringstream& s, const char* txt, ...);
+extern void writelnf(StringBuilder& s, const char* txt, ...);
 
 extern void SplitString(std::string_view txt, std::string_view delim, std::vector<std::string_view>& outParts);
 
@@ -110,6 +293,8 @@ extern std::string GuidFromText(std::string_view txt);
 
 extern bool IsFileSourceNewer(const fs::path& source, const fs::path& target);
 
+extern fs::file_time_type GetFileTime(const fs::path& path); // empty time if the file does not exist
+
 extern bool CopyNewerFile(const fs::path& source, const fs::path& target);
 
 //--
@@ -119,12 +304,14 @@ extern std::string_view NameEnumOption(BuildType type);
 extern std::string_view NameEnumOption(LibraryType type);
 extern std::string_view NameEnumOption(PlatformType type);
 extern std::string_view NameEnumOption(GeneratorType type);
+extern std::string_view NameEnumOption(ProfileGuidedStage type);
 
 extern bool ParseConfigurationType(std::string_view txt, ConfigurationType& outType);
 extern bool ParseBuildType(std::string_view txt, BuildType& outType);
 extern bool ParseLibraryType(std::string_view txt, LibraryType& outType);
 extern bool ParsePlatformType(std::string_view txt, PlatformType& outType);
 extern bool ParseGeneratorType(std::string_view txt, GeneratorType& outType);
+extern bool ParseProfileGuidedStage(std::string_view txt, ProfileGuidedStage& outType);
 
 //--
    
@@ -143,4 +330,44 @@ bool PushBackUnique(std::vector<T>& ar, const T& data)
     return true;
 }
 
+// List of unique values that keeps the insertion order (the generators depend on it) but checks the membership in O(1)
+template< typename T >
+class OrderedSet
+{
+public:
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    inline bool empty() const { return m_items.empty(); }
+    inline size_t size() const { return m_items.size(); }
+
+    inline const_iterator begin() const { return m_items.begin(); }
+    inline const_iterator end() const { return m_items.end(); }
+
+    inline const T& operator[](size_t index) const { return m_items[index]; }
+
+    inline const std::vector<T>& items() const { return m_items; }
+
+    inline bool contains(const T& data) const { return m_set.find(data) != m_set.end(); }
+
+    // adds value at the end of the list, returns false if it was already there
+    inline bool insert(const T& data)
+    {
+        if (!m_set.insert(data).second)
+            return false;
+
+        m_items.push_back(data);
+        return true;
+    }
+
+    inline void clear()
+    {
+        m_items.clear();
+        m_set.clear();
+    }
+
+private:
+    std::vector<T> m_items;
+    std::unordered_set<T> m_set;
+};
+
 //--
\ No newline at end of file